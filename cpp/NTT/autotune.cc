@@ -0,0 +1,90 @@
+#include "autotune.h"
+
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+#include "../helpers/mod_int.h"
+#include "../helpers/mod_int_simd.h"
+#include "../mobius/bit_reverse.h"
+#include "ntt.h"
+
+namespace {
+// Seconds of the fastest of a few runs.
+double best_time(auto&& func) {
+  constexpr size_t num_runs = 3;
+  double best = 1e300;
+  for (size_t i = 0; i < num_runs; ++i) {
+    auto start_time = std::chrono::steady_clock::now();
+    func();
+    auto end_time = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double>(end_time - start_time).count());
+  }
+  return best;
+}
+
+// Sets `best.*param` to the fastest of the candidates.
+void tune_param(tuning::Params& best, size_t tuning::Params::*param,
+                const char* name, const std::vector<size_t>& candidates,
+                auto&& func, std::ostream& log) {
+  double best_seconds = 1e300;
+  size_t best_value = best.*param;
+  for (size_t candidate : candidates) {
+    tuning::Params params = best;
+    params.*param = candidate;
+    tuning::set(params);
+    const double seconds = best_time(func);
+    log << name << " " << candidate << ": " << seconds << " (s)" << std::endl;
+    if (seconds < best_seconds) {
+      best_seconds = seconds;
+      best_value = candidate;
+    }
+  }
+  best.*param = best_value;
+}
+
+template <typename mint_t>
+tuning::Params tune(std::ostream& log) {
+  const tuning::Params initial = tuning::get();
+  tuning::Params best = initial;
+
+  // A regular and a six-step size.
+  std::vector<mint_t> small(1ull << 20), large(1ull << 23);
+  std::iota(small.begin(), small.end(), 1);
+  std::iota(large.begin(), large.end(), 1);
+  auto transforms = [&]() {
+    for (auto* v : {&small, &large}) {
+      ntt_bit_reversed(*v);
+      intt_bit_reversed(*v);
+    }
+  };
+  auto bit_reversal = [&]() { inplace_bit_reverse(large); };
+
+  std::vector<size_t> chunk_sizes;
+  for (size_t c = simd::Pack<mint_t>::width; c <= tuning::max_ntt_chunk_size;
+       c *= 2) {
+    chunk_sizes.push_back(c);
+  }
+  tune_param(best, &tuning::Params::ntt_chunk_size, "ntt_chunk_size",
+             chunk_sizes, transforms, log);
+  tune_param(best, &tuning::Params::ntt_parallel_blocks, "ntt_parallel_blocks",
+             {1, 2, 4, 8, 16}, transforms, log);
+  std::vector<size_t> lg2_chunks;
+  for (size_t c = tuning::min_bit_reverse_lg2_chunk;
+       c <= tuning::max_bit_reverse_lg2_chunk; ++c) {
+    lg2_chunks.push_back(c);
+  }
+  tune_param(best, &tuning::Params::bit_reverse_lg2_chunk,
+             "bit_reverse_lg2_chunk", lg2_chunks, bit_reversal, log);
+
+  tuning::set(initial);
+  return best;
+}
+}  // namespace
+
+tuning::Params autotune(std::ostream& log, uint64_t mod) {
+  log << "Tuning modulo " << mod << std::endl;
+  return dispatch_modulus(
+      mod, [&]<typename mint_t>() { return tune<mint_t>(log); });
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+#include "../helpers/moduli.h"
+#include "../helpers/tuning.h"
+
+// Measures the candidate tuning::Params on this host (one parameter at a
+// time, starting from the current ones), and returns the fastest. Logs the
+// timings to `log`. Takes a few seconds.
+// Times the transforms modulo `mod` (one of ntt_moduli), by default the
+// cheapest one, which count_primes uses whenever its transforms are large
+// enough.
+tuning::Params autotune(std::ostream& log, uint64_t mod = ntt_moduli[0]);
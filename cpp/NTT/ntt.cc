@@ -2,116 +2,749 @@
 
 #include <algorithm>
 #include <array>
+#include <span>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "../helpers/assertion.h"
 #include "../helpers/indicators.h"
+#include "../helpers/mapped_vector.h"
+#include "../helpers/math.h"
+#include "../helpers/mint_span.h"
 #include "../helpers/mod_int.h"
+#include "../helpers/mod_int_simd.h"
+#include "../helpers/parallel.h"
+#include "../helpers/tuning.h"
 #include "../mobius/bit_reverse.h"
+#include "ntt_plan.h"
 
 namespace {
 
-template <typename mint>
-consteval std::pair<mint, size_t> get_root() {
-  auto mod = mint::get_mod();
-  auto ord = mod - 1;
-  decltype(ord) part2 = 1;
-  size_t ord2 = 0;
-  while ((ord % 2) == 0) {
-    part2 *= 2;
-    ord /= 2;
-    ++ord2;
-  }
-
-  for (mint res = 2;; ++res) {
-    auto res1 = res.pow(ord);
-    if (res1.pow(part2 / 2) != 1) {
-      return {res1, ord2};
+// For i in [0, count):
+// DIT: (u[i], v[i]) <- (u[i] + w[i] * v[i], u[i] - w[i] * v[i])
+// DIF: (u[i], v[i]) <- (u[i] + v[i], (u[i] - v[i]) * w[i])
+template <typename Pack, bool dif, typename mint_t = typename Pack::mint_t>
+inline size_t butterfly_span(mint_t* u, mint_t* v, const mint_t* w,
+                             size_t count) {
+  size_t i = 0;
+  for (; i + Pack::width <= count; i += Pack::width) {
+    auto x = Pack::load(u + i);
+    auto y = Pack::load(v + i);
+    if constexpr (dif) {
+      (x + y).store(u + i);
+      (x - y).mul_normalized(Pack::load(w + i)).store(v + i);
+    } else {
+      y = y.mul_normalized(Pack::load(w + i));
+      (x + y).store(u + i);
+      (x - y).store(v + i);
     }
   }
+  return i;
 }
 
-inline void butterfly(auto& vec, size_t block_start, size_t block_size,
-                      size_t chunk_size, const auto& w_powers) {
-  for (size_t i = 0; i < chunk_size; i++) {
-    auto u = vec[block_start + i];
-    auto v = vec[block_start + i + block_size / 2] * w_powers[i];
-    vec[block_start + i] = u + v;
-    vec[block_start + i + block_size / 2] = u - v;
+// Two radix-2 stages (half block `half` and `2 * half`) in a single pass.
+// a[i + j * half] for j < 4 are the 4 inputs, t1 is the twiddle of the stage
+// of `half`, t2 of the stage of `2 * half`, and t3 = t2 * w_4 (the fourth root
+// of unity) is the twiddle of the stage of `2 * half` for the odd elements.
+// DIT applies the stage of `half` first, and DIF applies it last.
+template <typename Pack, bool dif, typename mint_t = typename Pack::mint_t>
+inline size_t radix4_span(mint_t* a, size_t half, const mint_t* t1,
+                          const mint_t* t2, const mint_t* t3, size_t count) {
+  mint_t *a0 = a, *a1 = a + half, *a2 = a + 2 * half, *a3 = a + 3 * half;
+  size_t i = 0;
+  for (; i + Pack::width <= count; i += Pack::width) {
+    auto w1 = Pack::load(t1 + i);
+    if constexpr (dif) {
+      auto x0 = Pack::load(a0 + i), x1 = Pack::load(a1 + i);
+      auto x2 = Pack::load(a2 + i), x3 = Pack::load(a3 + i);
+      auto y0 = x0 + x2, y2 = (x0 - x2).mul_normalized(Pack::load(t2 + i));
+      auto y1 = x1 + x3, y3 = (x1 - x3).mul_normalized(Pack::load(t3 + i));
+      (y0 + y1).store(a0 + i);
+      (y0 - y1).mul_normalized(w1).store(a1 + i);
+      (y2 + y3).store(a2 + i);
+      (y2 - y3).mul_normalized(w1).store(a3 + i);
+    } else {
+      auto x0 = Pack::load(a0 + i), x1 = Pack::load(a1 + i).mul_normalized(w1);
+      auto x2 = Pack::load(a2 + i), x3 = Pack::load(a3 + i).mul_normalized(w1);
+      auto y0 = x0 + x1, y1 = x0 - x1;
+      auto y2 = (x2 + x3).mul_normalized(Pack::load(t2 + i));
+      auto y3 = (x2 - x3).mul_normalized(Pack::load(t3 + i));
+      (y0 + y2).store(a0 + i);
+      (y0 - y2).store(a2 + i);
+      (y1 + y3).store(a1 + i);
+      (y1 - y3).store(a3 + i);
+    }
   }
+  return i;
 }
 
-template <typename T, size_t N>
-inline void generate_w_powers(std::array<T, N>& w_powers, T w,
-                              size_t max_power) {
-  constexpr size_t batch = 1ull << 3;
-  static_assert(batch <= N);
+// The stages of a pruned transform, where v (or the outputs written to it)
+// are known to be zero (or not needed), for i in [0, count):
+// DIT: u[i] <- u[i] + w[i] * v[i]
+// DIF: v[i] <- u[i] * w[i]
+template <typename Pack, bool dif, typename mint_t = typename Pack::mint_t>
+inline size_t pruned_butterfly_span(mint_t* u, mint_t* v, const mint_t* w,
+                                    size_t count) {
+  size_t i = 0;
+  for (; i + Pack::width <= count; i += Pack::width) {
+    if constexpr (dif) {
+      Pack::load(u + i).mul_normalized(Pack::load(w + i)).store(v + i);
+    } else {
+      (Pack::load(u + i) +
+       Pack::load(v + i).mul_normalized(Pack::load(w + i)))
+          .store(u + i);
+    }
+  }
+  return i;
+}
 
-  w_powers[0] = 1;
-  for (size_t i = 1; i < batch; ++i) w_powers[i] = w * w_powers[i - 1];
-  const auto jump = w.pow(batch);
-  for (size_t i = batch; i < max_power; i += batch)
-    for (size_t j = 0; j < batch; ++j)
-      w_powers[i + j] = jump * w_powers[i - batch + j];
+// The radix-3 step of the transforms of size 3 * m (see Radix3Plan), on
+// x_l = x[i + l * m] for l < 3, where t1 = scale * w^i, t2 = scale * w^(2i):
+// DIF: x_j <- w^(i * j) * sum_l omega^(l * j) x_l
+// DIT: x_j <- scale * sum_l omega^(l * j) w^(i * l) x_l (omega and w inverted)
+// If `pruned`, x_1 = x_2 = 0 for DIF, and only x_0 is needed for DIT.
+template <typename Pack, bool dif, bool pruned,
+          typename mint_t = typename Pack::mint_t>
+inline size_t radix3_span(mint_t* x, size_t m, const mint_t* t1,
+                          const mint_t* t2, mint_t omega, mint_t scale,
+                          size_t count) {
+  std::array<mint_t, Pack::width> omega1, omega2, scales;
+  omega1.fill(omega);
+  omega2.fill(omega * omega);
+  for (auto& o : omega2) o.normalize();
+  scales.fill(scale);
+  const auto o1 = Pack::load(omega1.data()), o2 = Pack::load(omega2.data());
+  const auto sc = Pack::load(scales.data());
+  mint_t *x0 = x, *x1 = x + m, *x2 = x + 2 * m;
+  size_t i = 0;
+  for (; i + Pack::width <= count; i += Pack::width) {
+    auto w1 = Pack::load(t1 + i), w2 = Pack::load(t2 + i);
+    if constexpr (dif && pruned) {
+      auto a = Pack::load(x0 + i);
+      a.mul_normalized(w1).store(x1 + i);
+      a.mul_normalized(w2).store(x2 + i);
+    } else if constexpr (dif) {
+      auto a = Pack::load(x0 + i), b = Pack::load(x1 + i);
+      auto c = Pack::load(x2 + i);
+      auto s = b + c, u = b.mul_normalized(o1) + c.mul_normalized(o2);
+      (a + s).store(x0 + i);
+      (a + u).mul_normalized(w1).store(x1 + i);
+      (a - s - u).mul_normalized(w2).store(x2 + i);
+    } else {
+      auto a = Pack::load(x0 + i).mul_normalized(sc);
+      auto b = Pack::load(x1 + i).mul_normalized(w1);
+      auto c = Pack::load(x2 + i).mul_normalized(w2);
+      auto s = b + c;
+      (a + s).store(x0 + i);
+      if constexpr (!pruned) {
+        auto u = b.mul_normalized(o1) + c.mul_normalized(o2);
+        (a + u).store(x1 + i);
+        (a - s - u).store(x2 + i);
+      }
+    }
+  }
+  return i;
 }
-}  // namespace
 
-void details::ntt_impl(std::vector<mint>& vec, bool inverse,
-                       std::optional<std::string> desc) {
-  constexpr auto root_info = get_root<mint>();
+// The stages with half block < 2^lg2_size applied to a block of 2^lg2_size
+// elements at once (the first stages of DIT, the last ones of DIF), unrolled
+// at compile time, with the twiddles as constants. Those stages have fewer
+// butterflies per twiddle than the width of the packs (codelet_lg2_size), and
+// one pass over the vector replaces a pass per (radix-4) stage.
+// The pointwise product of the fused transforms (see ntt.h) is applied here
+// too: After the last stage of DIF, and before the first stage of DIT.
+constexpr size_t max_codelet_lg2_size = 4;
+template <typename mint_t>
+constexpr size_t codelet_lg2_size = std::clamp<size_t>(
+    __builtin_ctzll(simd::Pack<mint_t>::width), 3, max_codelet_lg2_size);
 
-  auto [root, ord2] = root_info;
-  while (vec.size() != (1ull << ord2)) {
-    root = root.pow(2);
-    --ord2;
-    ASSERT_FATAL(ord2 != 0);  // Not a power of two!
-  }
+template <typename mint_t, bool inverse>
+consteval auto codelet_twiddles() {
+  // [half + k] = w_{2 * half}^k, like NttPlan.
+  std::array<ShoupMultiplier<mint_t>, 1ull << max_codelet_lg2_size> res{};
+  auto [root, ord2] = details::get_root<mint_t>();
   if (inverse) root = root.inverse();
+  for (size_t half = 1; half < res.size(); half *= 2) {
+    const mint_t w = root.pow((1ull << ord2) / (2 * half));
+    mint_t cur = 1;
+    for (size_t k = 0; k < half; ++k, cur *= w) res[half + k] = cur;
+  }
+  return res;
+}
+template <typename mint_t, bool inverse>
+constexpr auto codelet_twiddles_v = codelet_twiddles<mint_t, inverse>();
 
-  inplace_bit_reverse(vec);
-  size_t fft_size = vec.size();
+template <size_t lg2_size, bool dif, bool inverse, bool multiply,
+          typename mint_t>
+inline void codelet(mint_t* data, const mint_t* multiplier) {
+  constexpr size_t size = 1ull << lg2_size;
+  constexpr auto& w = codelet_twiddles_v<mint_t, inverse>;
+  std::array<mint_t, size> x;
+#pragma GCC unroll 8
+  for (size_t i = 0; i < size; ++i) {
+    x[i] = data[i];
+    if constexpr (multiply && !dif) x[i] *= multiplier[i];
+  }
+  auto stage = [&]<size_t half>(std::integral_constant<size_t, half>) {
+#pragma GCC unroll 8
+    for (size_t j = 0; j < size; j += 2 * half) {
+#pragma GCC unroll 8
+      for (size_t k = 0; k < half; ++k) {
+        mint_t &u = x[j + k], &v = x[j + k + half];
+        if constexpr (dif) {
+          const mint_t diff = u - v;
+          u += v;
+          v = k == 0 ? diff : diff * w[half + k];
+        } else {
+          const mint_t y = k == 0 ? v : v * w[half + k];
+          v = u - y;
+          u += y;
+        }
+      }
+    }
+  };
+  [&]<size_t... lg2_half>(std::index_sequence<lg2_half...>) {
+    if constexpr (dif) {
+      (stage(std::integral_constant<size_t, size / 2 / (1ull << lg2_half)>()),
+       ...);
+    } else {
+      (stage(std::integral_constant<size_t, 1ull << lg2_half>()), ...);
+    }
+  }(std::make_index_sequence<lg2_size>());
+#pragma GCC unroll 8
+  for (size_t i = 0; i < size; ++i) {
+    if constexpr (multiply && dif) x[i] *= multiplier[i];
+    data[i] = x[i];
+  }
+}
 
-  std::optional<tqdm::TRange<size_t>> tq;
-  if (desc.has_value()) {
-    tq = tqdm::title_range<size_t>(desc.value(), ord2 - 1);
-  }
-  // We compute the w_powers (the coefficient for the butterfly) in chunks.
-  constexpr size_t in_block_chunk_size = 1ull << 3;
-  // We reuse the same chunk across multiple blocks to reduce computation.
-  constexpr size_t num_parallel_blocks = 1ull << 2;
-
-  std::array<mint, in_block_chunk_size> w_powers;
-  for (size_t block_size = 2; block_size <= fft_size; block_size *= 2) {
-    const auto cur_w = root.pow(fft_size / block_size);
-    if (block_size / 2 <= in_block_chunk_size) {
-      // SmallBlock
-      generate_w_powers(w_powers, cur_w, block_size / 2);
-      for (size_t block_start = 0; block_start < fft_size;
-           block_start += block_size)
-        butterfly(vec, block_start, block_size, block_size / 2, w_powers);
+// Applies the codelet of 2^lg2_size to every block of data[0, size).
+template <size_t lg2_size, bool dif, typename mint_t>
+void codelet_blocks(mint_t* data, size_t size, bool inverse,
+                    const mint_t* multiplier) {
+  constexpr size_t block_size = 1ull << lg2_size;
+  auto apply = [&](auto inverse, auto multiply) {
+    for (size_t i = 0; i < size; i += block_size) {
+      codelet<lg2_size, dif, inverse, multiply>(
+          data + i, multiply ? multiplier + i : nullptr);
+    }
+  };
+  using True = std::true_type;
+  using False = std::false_type;
+  if (inverse) {
+    multiplier ? apply(True(), True()) : apply(True(), False());
+  } else {
+    multiplier ? apply(False(), True()) : apply(False(), False());
+  }
+}
+
+// Applies the stages with half block < 2^lg2_size (<= max_codelet_lg2_size)
+// to data[0, size), and the product by multiplier[0, size) if not null.
+template <bool dif, typename mint_t>
+void apply_codelets(mint_t* data, size_t size, size_t lg2_size, bool inverse,
+                    const mint_t* multiplier) {
+  switch (lg2_size) {
+    case 0:
+      if (multiplier) codelet_blocks<0, dif>(data, size, inverse, multiplier);
+      return;
+    case 1:
+      return codelet_blocks<1, dif>(data, size, inverse, multiplier);
+    case 2:
+      return codelet_blocks<2, dif>(data, size, inverse, multiplier);
+    case 3:
+      return codelet_blocks<3, dif>(data, size, inverse, multiplier);
+    case 4:
+      return codelet_blocks<4, dif>(data, size, inverse, multiplier);
+  }
+  static_assert(max_codelet_lg2_size == 4);
+  ASSERT_FATAL(false);
+}
+
+// We load the w_powers (the coefficient for the butterfly) in chunks, and
+// reuse the same chunk across multiple blocks (it stays in registers). The
+// sizes are tuning::Params::ntt_chunk_size (at least a pack) and
+// ntt_parallel_blocks.
+constexpr size_t max_chunk_size = tuning::max_ntt_chunk_size;
+template <typename mint_t>
+size_t get_chunk_size(const tuning::Params& params) {
+  static_assert(simd::Pack<mint_t>::width <= max_chunk_size);
+  return std::max(params.ntt_chunk_size, simd::Pack<mint_t>::width);
+}
+// Below this many butterflies a thread costs more than it saves.
+constexpr size_t min_butterflies_per_thread = 1ull << 14;
+
+// Above this size we use the six-step order (see ntt_impl).
+constexpr size_t six_step_min_size = 1ull << 22;
+// The length of a row in the six-step order. A row should fit in L2.
+constexpr size_t six_step_row_size = 1ull << 16;
+// The number of bytes in a strip of columns in the six-step order.
+constexpr size_t six_step_strip_bytes = 1ull << 20;
+// Out-of-core, a strip reads at least a page of every row, so that each page
+// is read from the disk once per column pass.
+constexpr size_t out_of_core_min_strip_row_bytes = 1ull << 12;
+
+// Applies the stage(s) of half block `half` on the in block indices
+// [k, k + count) (count <= max_chunk_size) of the blocks that start in
+// data[0, blocks_size).
+template <size_t radix, bool dif, typename mint_t>
+void apply_chunk(mint_t* data, size_t blocks_size, const NttPlan<mint_t>& plan,
+                 size_t half, size_t k, size_t count, bool inverse) {
+  static_assert(radix == 2 || radix == 4);
+  using Pack = simd::Pack<mint_t>;
+  using Scalar = simd::ScalarPack<mint_t>;
+  std::array<mint_t, max_chunk_size> buffer1, buffer2, buffer3;
+  const mint_t* t1 = plan.twiddles(half, k, count, inverse, buffer1.data());
+  const mint_t *t2 = nullptr, *t3 = nullptr;
+  if constexpr (radix == 4) {
+    t2 = plan.twiddles(2 * half, k, count, inverse, buffer2.data());
+    t3 = plan.twiddles(2 * half, half + k, count, inverse, buffer3.data());
+  }
+  for (size_t j = 0; j < blocks_size; j += radix * half) {
+    mint_t* a = data + j + k;
+    if constexpr (radix == 2) {
+      size_t done = butterfly_span<Pack, dif>(a, a + half, t1, count);
+      butterfly_span<Scalar, dif>(a + done, a + half + done, t1 + done,
+                                  count - done);
     } else {
-      // LargeBlock
-      const mint jump = cur_w.pow(in_block_chunk_size);
-      const size_t parallel_blocks_size =
-          std::min(fft_size, block_size * num_parallel_blocks);
-      for (size_t idx = 0; idx < fft_size; idx += parallel_blocks_size) {
-        generate_w_powers(w_powers, cur_w, in_block_chunk_size);
-        for (size_t in_block_idx = 0; in_block_idx < block_size / 2;
-             in_block_idx += in_block_chunk_size) {
-          for (size_t j = 0; j < parallel_blocks_size; j += block_size) {
-            size_t start = idx + j + in_block_idx;
-            butterfly(vec, start, block_size, in_block_chunk_size, w_powers);
+      size_t done = radix4_span<Pack, dif>(a, half, t1, t2, t3, count);
+      radix4_span<Scalar, dif>(a + done, half, t1 + done, t2 + done,
+                               t3 + done, count - done);
+    }
+  }
+}
+
+// Calls func(radix, half) for the passes that cover the stages with half
+// blocks in [half_begin, half_end): Radix-4 passes (two stages each), and a
+// single radix-2 pass of `half_begin` if the number of stages is odd.
+// DIT goes from the small blocks to the large ones, and DIF the other way.
+template <bool dif, typename Func>
+void for_each_pass(size_t half_begin, size_t half_end, Func&& func) {
+  const bool odd = __builtin_ctzll(half_end / half_begin) % 2 == 1;
+  const size_t radix4_begin = odd ? 2 * half_begin : half_begin;
+  if (odd && !dif) func(std::integral_constant<size_t, 2>(), half_begin);
+  if constexpr (dif) {
+    for (size_t half = half_end / 4; half >= radix4_begin; half /= 4)
+      func(std::integral_constant<size_t, 4>(), half);
+  } else {
+    for (size_t half = radix4_begin; half < half_end; half *= 4)
+      func(std::integral_constant<size_t, 4>(), half);
+  }
+  if (odd && dif) func(std::integral_constant<size_t, 2>(), half_begin);
+}
+
+// Applies the stage(s) starting at half block `half` to all the blocks.
+template <size_t radix, bool dif, typename mint_t>
+void apply_stage(mint_t* data, size_t fft_size, const NttPlan<mint_t>& plan,
+                 size_t half, bool inverse, const tuning::Params& params) {
+  const size_t block_size = radix * half;
+  const size_t chunk_size = std::min(half, get_chunk_size<mint_t>(params));
+  const size_t parallel_blocks_size =
+      std::min(fft_size, block_size * params.ntt_parallel_blocks);
+  // A task is a single chunk of a group of parallel blocks. The groups are
+  // independent, and chunks are split as well so that the last stages
+  // (where there are less groups than threads) still use all the threads.
+  const size_t chunks_per_group = half / chunk_size;
+  const size_t num_tasks = fft_size / parallel_blocks_size * chunks_per_group;
+  const size_t butterflies_per_task =
+      parallel_blocks_size / block_size * chunk_size * (radix / 2);
+  parallel::parallel_for(
+      num_tasks,
+      [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; ++task) {
+          const size_t idx = task / chunks_per_group * parallel_blocks_size;
+          const size_t in_block_idx = task % chunks_per_group * chunk_size;
+          apply_chunk<radix, dif>(data + idx, parallel_blocks_size, plan,
+                                  half, in_block_idx, chunk_size, inverse);
+        }
+      },
+      min_butterflies_per_thread / butterflies_per_task);
+}
+
+/**
+ * The six-step (Bailey) order, for vectors that do not fit in the cache.
+ * View the (bit reversed) vector as a matrix with rows of length n2:
+ *  1. The stages with half block < n2 are independent transforms of the rows.
+ *     Each row fits in L2, and we apply all those stages to it at once.
+ *  2. The rest of the stages are transforms of the columns, where the
+ *     twiddles also include the "twiddle multiply" step. We apply them to a
+ *     strip of adjacent columns at a time, which fits in the cache.
+ * Since the stages of a DIT transform on bit reversed input already read the
+ * columns in place, there is no need for the transposes.
+ * DIF does the same steps in reverse order (columns first).
+ */
+template <bool dif, typename mint_t>
+void six_step(mint_t* data, size_t fft_size, const NttPlan<mint_t>& plan,
+              bool inverse, const tuning::Params& params,
+              const mint_t* multiplier) {
+  const size_t chunk_size = get_chunk_size<mint_t>(params);
+  const size_t n2 = six_step_row_size;
+  const size_t n1 = fft_size / n2;
+  ASSERT_FATAL(n1 > 1);
+  constexpr size_t lg2_codelet = codelet_lg2_size<mint_t>;
+  constexpr size_t codelet_size = 1ull << lg2_codelet;
+  auto rows = [&]() {
+    parallel::parallel_for(n1, [&](size_t begin, size_t end) {
+      for (size_t row = begin; row < end; ++row) {
+        mint_t* row_data = data + row * n2;
+        const mint_t* row_multiplier =
+            multiplier ? multiplier + row * n2 : nullptr;
+        if constexpr (!dif) {
+          apply_codelets<dif>(row_data, n2, lg2_codelet, inverse,
+                              row_multiplier);
+        }
+        for_each_pass<dif>(codelet_size, n2, [&](auto radix, size_t half) {
+          const size_t count = std::min(half, chunk_size);
+          for (size_t k = 0; k < half; k += count) {
+            apply_chunk<radix, dif>(row_data, n2, plan, half, k, count,
+                                    inverse);
           }
-          for (size_t i = 0; i < in_block_chunk_size; ++i) w_powers[i] *= jump;
+        });
+        if constexpr (dif) {
+          apply_codelets<dif>(row_data, n2, lg2_codelet, inverse,
+                              row_multiplier);
         }
       }
+    });
+  };
+  auto columns = [&]() {
+    const size_t min_strip_width =
+        storage::out_of_core()
+            ? out_of_core_min_strip_row_bytes / sizeof(mint_t)
+            : chunk_size;
+    const size_t strip_width = std::clamp(
+        six_step_strip_bytes / (n1 * sizeof(mint_t)), min_strip_width, n2);
+    parallel::parallel_for(n2 / strip_width, [&](size_t begin, size_t end) {
+      for (size_t strip = begin; strip < end; ++strip) {
+        const size_t column = strip * strip_width;
+        for_each_pass<dif>(n2, fft_size, [&](auto radix, size_t half) {
+          for (size_t row = 0; row < half; row += n2) {
+            for (size_t k = row + column; k < row + column + strip_width;
+                 k += chunk_size) {
+              apply_chunk<radix, dif>(data, fft_size, plan, half, k,
+                                      chunk_size, inverse);
+            }
+          }
+        });
+      }
+    });
+  };
+  if constexpr (dif) {
+    columns();
+    rows();
+  } else {
+    rows();
+    columns();
+  }
+}
+
+// Applies the stages with half block < block_size to every block of
+// block_size in vec, and the product by multiplier (if not null) after the
+// last stage of DIF, or before the first stage of DIT.
+template <bool dif, typename mint_t>
+void transform(std::span<mint_t> vec, size_t block_size,
+               const NttPlan<mint_t>& plan, bool inverse,
+               const tuning::Params& params, const mint_t* multiplier,
+               std::optional<tqdm::TRange<size_t>>& tq) {
+  if (block_size >= six_step_min_size) {
+    for (size_t i = 0; i < vec.size(); i += block_size) {
+      six_step<dif>(vec.data() + i, block_size, plan, inverse, params,
+                    multiplier ? multiplier + i : nullptr);
     }
     if (tq.has_value()) {
-      ++tq.value();
+      for (size_t i = 1; i < block_size; i *= 2) ++tq.value();
+    }
+  } else {
+    const size_t lg2_codelet =
+        std::min(size_t(__builtin_ctzll(block_size)), codelet_lg2_size<mint_t>);
+    auto codelets = [&]() {
+      if (lg2_codelet == 0 && !multiplier) return;
+      const size_t codelet_size = 1ull << lg2_codelet;
+      parallel::parallel_for(
+          vec.size() / codelet_size,
+          [&](size_t begin, size_t end) {
+            const size_t offset = begin * codelet_size;
+            apply_codelets<dif>(vec.data() + offset,
+                                (end - begin) * codelet_size, lg2_codelet,
+                                inverse,
+                                multiplier ? multiplier + offset : nullptr);
+          },
+          min_butterflies_per_thread / codelet_size);
+      if (tq.has_value()) {
+        for (size_t i = 0; i < lg2_codelet; ++i) ++tq.value();
+      }
+    };
+    if constexpr (!dif) codelets();
+    for_each_pass<dif>(
+        1ull << lg2_codelet, block_size, [&](auto radix, size_t half) {
+          apply_stage<radix, dif>(vec.data(), vec.size(), plan, half, inverse,
+                                  params);
+          if (tq.has_value()) {
+            for (size_t i = 0; i < radix / 2; ++i) ++tq.value();
+          }
+        });
+    if constexpr (dif) codelets();
+  }
+}
+
+// A stage where only the first `prefix` (<= half) elements of each half
+// block matter: For DIF the second halves are zero, and for DIT only the
+// first halves of the outputs are needed.
+template <bool dif, typename mint_t>
+void apply_pruned_stage(std::span<mint_t> vec, const NttPlan<mint_t>& plan,
+                        size_t half, size_t prefix, bool inverse,
+                        const tuning::Params& params) {
+  using Pack = simd::Pack<mint_t>;
+  using Scalar = simd::ScalarPack<mint_t>;
+  const size_t chunk_size = get_chunk_size<mint_t>(params);
+  const size_t chunks_per_block = (prefix + chunk_size - 1) / chunk_size;
+  const size_t num_tasks = vec.size() / (2 * half) * chunks_per_block;
+  parallel::parallel_for(
+      num_tasks,
+      [&](size_t begin, size_t end) {
+        std::array<mint_t, max_chunk_size> buffer;
+        for (size_t task = begin; task < end; ++task) {
+          const size_t k = task % chunks_per_block * chunk_size;
+          const size_t count = std::min(chunk_size, prefix - k);
+          mint_t* u = vec.data() + task / chunks_per_block * 2 * half + k;
+          const mint_t* w =
+              plan.twiddles(half, k, count, inverse, buffer.data());
+          size_t done = pruned_butterfly_span<Pack, dif>(u, u + half, w, count);
+          pruned_butterfly_span<Scalar, dif>(u + done, u + half + done,
+                                             w + done, count - done);
+        }
+      },
+      min_butterflies_per_thread / chunk_size);
+}
+
+// The radix-3 step on all of vec (of size 3 * m), see radix3_span. Only the
+// first `prefix` elements matter (are nonzero for DIF, needed for DIT).
+template <typename mint_t>
+void apply_radix3(std::span<mint_t> vec, const Radix3Plan<mint_t>& plan,
+                  size_t prefix, bool inverse, const tuning::Params& params) {
+  using Pack = simd::Pack<mint_t>;
+  using Scalar = simd::ScalarPack<mint_t>;
+  const size_t m = plan.m();
+  const bool pruned = prefix <= m;
+  const size_t count = pruned ? prefix : m;
+  const size_t chunk_size = get_chunk_size<mint_t>(params);
+  const mint_t omega = plan.omega(inverse), scale = plan.scale(inverse);
+  auto apply = [&](auto dif, auto pruned) {
+    parallel::parallel_for(
+        (count + chunk_size - 1) / chunk_size,
+        [&](size_t begin, size_t end) {
+          std::array<mint_t, max_chunk_size> t1, t2;
+          for (size_t chunk = begin; chunk < end; ++chunk) {
+            const size_t k = chunk * chunk_size;
+            const size_t len = std::min(chunk_size, count - k);
+            plan.twiddles(k, len, inverse, t1.data(), t2.data());
+            mint_t* x = vec.data() + k;
+            size_t done = radix3_span<Pack, dif, pruned>(
+                x, m, t1.data(), t2.data(), omega, scale, len);
+            radix3_span<Scalar, dif, pruned>(x + done, m, t1.data() + done,
+                                             t2.data() + done, omega, scale,
+                                             len - done);
+          }
+        },
+        min_butterflies_per_thread / chunk_size);
+  };
+  using True = std::true_type;
+  using False = std::false_type;
+  if (inverse) {
+    pruned ? apply(False(), True()) : apply(False(), False());
+  } else {
+    pruned ? apply(True(), True()) : apply(True(), False());
+  }
+}
+
+// The power of two transforms, see ntt_impl.
+template <typename mint_t>
+void power_of_2_ntt(std::span<mint_t> vec, bool inverse, bool bit_reversed,
+                    size_t pruned_size, std::span<const mint_t> multiplier,
+                    const tuning::Params& params,
+                    std::optional<tqdm::TRange<size_t>>& tq) {
+  const size_t fft_size = vec.size();
+  const auto plan = NttPlan<mint_t>::get(fft_size);
+  // The stages with half >= block_size only touch the first pruned_size
+  // elements of each half block. The rest are regular transforms of the
+  // blocks.
+  const size_t block_size = ceil_power_of_2(std::max<size_t>(pruned_size, 1));
+  const mint_t* mult = multiplier.empty() ? nullptr : multiplier.data();
+
+  // DIT takes bit reversed input to natural order output, and DIF the
+  // other way around.
+  if (bit_reversed && !inverse) {
+    for (size_t half = fft_size / 2; half >= block_size; half /= 2) {
+      apply_pruned_stage</*dif=*/true>(vec, *plan, half, pruned_size, inverse,
+                                       params);
+      if (tq.has_value()) ++tq.value();
+    }
+    transform</*dif=*/true>(vec, block_size, *plan, inverse, params, mult,
+                            tq);
+  } else {
+    if (!bit_reversed) inplace_bit_reverse(vec);
+    transform</*dif=*/false>(vec, block_size, *plan, inverse, params, mult,
+                             tq);
+    for (size_t half = block_size; half < fft_size; half *= 2) {
+      apply_pruned_stage</*dif=*/false>(vec, *plan, half, pruned_size,
+                                        inverse, params);
+      if (tq.has_value()) ++tq.value();
     }
   }
   if (inverse) {
-    mint v = mint(fft_size).inverse();
-    for (auto& i : vec) i *= v;
+    parallel::parallel_for(
+        pruned_size,
+        [&](size_t begin, size_t end) {
+          mint_span::scale(vec.subspan(begin, end - begin),
+                           plan->size_inverse());
+        },
+        min_butterflies_per_thread);
   }
-}
\ No newline at end of file
+}
+
+// Moves vec[k] to vec[bit_reversed_position(k)], or back if `inverse`.
+// The natural order is an m x 3 matrix, and the bit reversed order is its
+// transpose (the thirds) with each third bit reversed. Transposes in place:
+// every `block` rows through a buffer, and then the (m / block) x 3 matrix of
+// those blocks by following the cycles of its transposition.
+template <typename mint_t>
+void permute_to_bit_reversed(std::span<mint_t> vec, bool inverse) {
+  const size_t m = vec.size() / 3;
+  const size_t block = std::min<size_t>(m, 1ull << 10);
+  const size_t num_blocks = m / block;
+  auto transpose_blocks = [&](bool to_thirds) {
+    parallel::parallel_for(
+        num_blocks,
+        [&](size_t begin, size_t end) {
+          std::vector<mint_t> buffer(3 * block);
+          for (size_t b = begin; b < end; ++b) {
+            mint_t* p = vec.data() + 3 * block * b;
+            std::copy(p, p + 3 * block, buffer.begin());
+            for (size_t j = 0; j < block; ++j) {
+              for (size_t r = 0; r < 3; ++r) {
+                if (to_thirds) {
+                  p[r * block + j] = buffer[3 * j + r];
+                } else {
+                  p[3 * j + r] = buffer[r * block + j];
+                }
+              }
+            }
+          }
+        },
+        std::max<size_t>(min_butterflies_per_thread / block, 1));
+  };
+  // The block at slot s moves to slot `to_thirds ? dst(s) : src(s)`.
+  auto transpose_slots = [&](bool to_thirds) {
+    const size_t num_slots = 3 * num_blocks;
+    auto dst = [&](size_t s) { return s % 3 * num_blocks + s / 3; };
+    auto src = [&](size_t s) { return 3 * (s % num_blocks) + s / num_blocks; };
+    auto from = [&](size_t s) { return to_thirds ? src(s) : dst(s); };
+    std::vector<size_t> leaders;
+    std::vector<bool> visited(num_slots);
+    for (size_t s = 0; s < num_slots; ++s) {
+      if (visited[s]) continue;
+      leaders.push_back(s);
+      for (size_t cur = s; !visited[cur]; cur = from(cur)) visited[cur] = true;
+    }
+    parallel::parallel_for(leaders.size(), [&](size_t begin, size_t end) {
+      std::vector<mint_t> buffer(block);
+      auto slot = [&](size_t s) { return vec.data() + s * block; };
+      for (size_t i = begin; i < end; ++i) {
+        const size_t leader = leaders[i];
+        std::copy(slot(leader), slot(leader) + block, buffer.begin());
+        size_t cur = leader;
+        for (size_t next = from(cur); next != leader; next = from(cur)) {
+          std::copy(slot(next), slot(next) + block, slot(cur));
+          cur = next;
+        }
+        std::copy(buffer.begin(), buffer.end(), slot(cur));
+      }
+    });
+  };
+  auto reverse_thirds = [&]() {
+    for (size_t third = 0; third < 3; ++third) {
+      auto span = vec.subspan(third * m, m);
+      inplace_bit_reverse(span);
+    }
+  };
+  if (!inverse) {
+    transpose_blocks(true);
+    transpose_slots(true);
+    reverse_thirds();
+  } else {
+    reverse_thirds();
+    transpose_slots(false);
+    transpose_blocks(false);
+  }
+}
+}  // namespace
+
+/**
+ * Sizes 3 * m (m a power of two) are a radix-3 step and 3 power of two
+ * transforms of size m (the contiguous thirds): DIF does the radix-3 step
+ * first, and leaves the thirds in bit reversed order (see
+ * bit_reversed_position). DIT is the inverse. The natural order transforms
+ * permute to (or from) that order.
+ */
+template <typename mint_t>
+void details::ntt_impl(std::span<mint_t> vec, bool inverse,
+                       bool bit_reversed, size_t pruned_size,
+                       std::span<const mint_t> multiplier,
+                       std::optional<std::string> desc) {
+  const size_t fft_size = vec.size();
+  const auto params = tuning::get();
+  ASSERT_FATAL(is_ntt_size(fft_size));
+  ASSERT_FATAL(pruned_size <= fft_size);
+  ASSERT_FATAL(bit_reversed || pruned_size == fft_size);
+  ASSERT_FATAL(multiplier.empty() ||
+               (bit_reversed && multiplier.size() == fft_size));
+  const bool power_of_2 = (fft_size & (fft_size - 1)) == 0;
+  const size_t m = power_of_2 ? fft_size : fft_size / 3;
+  const size_t lg2_m = __builtin_ctzll(m);
+
+  std::optional<tqdm::TRange<size_t>> tq;
+  if (desc.has_value()) {
+    tq = tqdm::title_range<size_t>(desc.value(),
+                                   power_of_2 ? lg2_m : 3 * lg2_m + 1);
+  }
+  if (power_of_2) {
+    power_of_2_ntt(vec, inverse, bit_reversed, pruned_size, multiplier, params,
+                   tq);
+    return;
+  }
+  if (!bit_reversed && inverse) permute_to_bit_reversed(vec, false);
+  const auto plan = Radix3Plan<mint_t>::get(m);
+  const size_t third_pruned_size = std::min(pruned_size, m);
+  if (!inverse) {
+    apply_radix3(vec, *plan, pruned_size, inverse, params);
+    if (tq.has_value()) ++tq.value();
+  }
+  for (size_t third = 0; third < 3; ++third) {
+    power_of_2_ntt(
+        vec.subspan(third * m, m), inverse, /*bit_reversed=*/true,
+        third_pruned_size,
+        multiplier.empty() ? multiplier : multiplier.subspan(third * m, m),
+        params, tq);
+  }
+  if (inverse) {
+    apply_radix3(vec, *plan, pruned_size, inverse, params);
+    if (tq.has_value()) ++tq.value();
+  }
+  if (!bit_reversed && !inverse) permute_to_bit_reversed(vec, true);
+}
+
+template void details::ntt_impl(std::span<mint>, bool, bool, size_t,
+                                std::span<const mint>,
+                                std::optional<std::string>);
+template void details::ntt_impl(std::span<mint2>, bool, bool, size_t,
+                                std::span<const mint2>,
+                                std::optional<std::string>);
+template void details::ntt_impl(std::span<mint3>, bool, bool, size_t,
+                                std::span<const mint3>,
+                                std::optional<std::string>);
+template void details::ntt_impl(std::span<mint32>, bool, bool, size_t,
+                                std::span<const mint32>,
+                                std::optional<std::string>);
+template void details::ntt_impl(std::span<mint32_2>, bool, bool, size_t,
+                                std::span<const mint32_2>,
+                                std::optional<std::string>);
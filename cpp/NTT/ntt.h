@@ -1,21 +1,153 @@
 #pragma once
 #include <optional>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../helpers/math.h"
 #include "../helpers/mod_int.h"
+#include "../mobius/bit_reverse.h"
 
+// The transform sizes are 2^k, and 3 * 2^k (all the moduli have 3 | MOD - 1).
+inline bool is_ntt_size(size_t n) {
+  if (n % 3 == 0) n /= 3;
+  return n != 0 && (n & (n - 1)) == 0;
+}
+
+// The smallest transform size >= n.
+inline size_t ceil_ntt_size(size_t n) {
+  const size_t power_of_2 = ceil_power_of_2(n);
+  if (power_of_2 >= 4 && power_of_2 / 4 * 3 >= n) return power_of_2 / 4 * 3;
+  return power_of_2;
+}
+
+// The position of f(w^k) in the output of ntt_bit_reversed of size n. For
+// n = 3 * m, the thirds are the values at k = 0, 1, 2 (mod 3), each in bit
+// reversed order.
+inline size_t bit_reversed_position(size_t k, size_t n) {
+  if ((n & (n - 1)) == 0) return bit_reverse(k, n);
+  const size_t m = n / 3;
+  return k % 3 * m + bit_reverse(k / 3, m);
+}
+
+// The inverse of bit_reversed_position: the k of the value at `position`.
+inline size_t bit_reversed_frequency(size_t position, size_t n) {
+  if ((n & (n - 1)) == 0) return bit_reverse(position, n);
+  const size_t m = n / 3;
+  return 3 * bit_reverse(position % m, m) + position / m;
+}
+
+// The transforms run on parallel::get_num_threads() threads, the result does
+// not depend on the number of threads.
 namespace details {
-void ntt_impl(std::vector<mint>& v, bool inverse,
+// Instantiated for the NttModInts (see helpers/moduli.h).
+// If `multiplier` is not empty (only for bit_reversed), the output of the
+// forward transform, or the input of the inverse one, is multiplied by it
+// pointwise in the same pass as the last (first) stages.
+template <typename mint_t>
+void ntt_impl(std::span<mint_t> v, bool inverse, bool bit_reversed,
+              size_t pruned_size, std::span<const mint_t> multiplier = {},
               std::optional<std::string> desc = std::nullopt);
 }  // namespace details
 
-template <typename... Args>
-void ntt(std::vector<mint>& v, Args... args) {
-  return details::ntt_impl(v, /*inverse=*/false, args...);
+// The vectors can use any allocator (e.g. mapped_vector for out-of-core).
+template <typename mint_t, typename Alloc, typename... Args>
+void ntt(std::vector<mint_t, Alloc>& v, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/false,
+                           /*bit_reversed=*/false, v.size(), {}, args...);
+}
+
+template <typename mint_t, typename Alloc, typename... Args>
+void intt(std::vector<mint_t, Alloc>& v, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/true,
+                           /*bit_reversed=*/false, v.size(), {}, args...);
+}
+
+// Like ntt, but leaves the result in bit reversed order, which saves the
+// permutation: v[bit_reversed_position(k, n)] = f(w^k). Good enough for
+// pointwise products, intt_bit_reversed is the inverse.
+template <typename mint_t, typename Alloc, typename... Args>
+void ntt_bit_reversed(std::vector<mint_t, Alloc>& v, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/false,
+                           /*bit_reversed=*/true, v.size(), {}, args...);
+}
+
+// Inverse of ntt_bit_reversed: Takes the values in bit reversed order.
+template <typename mint_t, typename Alloc, typename... Args>
+void intt_bit_reversed(std::vector<mint_t, Alloc>& v, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/true,
+                           /*bit_reversed=*/true, v.size(), {}, args...);
+}
+
+// Like ntt_bit_reversed, for input that is zero from index `nonzero_size` on:
+// The first stages skip the butterflies on the known zeros.
+template <typename mint_t, typename Alloc, typename... Args>
+void ntt_bit_reversed_pruned(std::vector<mint_t, Alloc>& v,
+                             size_t nonzero_size, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/false,
+                           /*bit_reversed=*/true, nonzero_size, {}, args...);
 }
 
-template <typename... Args>
-void intt(std::vector<mint>& v, Args... args) {
-  return details::ntt_impl(v, /*inverse=*/true, args...);
-}
\ No newline at end of file
+// Like intt_bit_reversed, when only the first `needed_size` outputs are
+// needed: The last stages skip the others, which are left unspecified.
+template <typename mint_t, typename Alloc, typename... Args>
+void intt_bit_reversed_pruned(std::vector<mint_t, Alloc>& v,
+                              size_t needed_size, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/true,
+                           /*bit_reversed=*/true, needed_size, {}, args...);
+}
+
+// The convolutions, with the pointwise products fused into the transforms
+// (no separate pass over the vectors). `other` holds values in the bit
+// reversed order of ntt_bit_reversed, and has the size of v.
+
+// v <- ntt_bit_reversed_pruned(v, nonzero_size) * other (pointwise).
+template <typename mint_t, typename Alloc, typename Alloc2, typename... Args>
+void ntt_bit_reversed_multiply(std::vector<mint_t, Alloc>& v,
+                               const std::vector<mint_t, Alloc2>& other,
+                               size_t nonzero_size, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/false,
+                           /*bit_reversed=*/true, nonzero_size,
+                           std::span<const mint_t>(other), args...);
+}
+
+// v <- intt_bit_reversed_pruned(v * other (pointwise), needed_size).
+template <typename mint_t, typename Alloc, typename Alloc2, typename... Args>
+void intt_bit_reversed_multiply(std::vector<mint_t, Alloc>& v,
+                                const std::vector<mint_t, Alloc2>& other,
+                                size_t needed_size, Args... args) {
+  return details::ntt_impl(std::span<mint_t>(v), /*inverse=*/true,
+                           /*bit_reversed=*/true, needed_size,
+                           std::span<const mint_t>(other), args...);
+}
+
+// The first `truncate` coefficients of the product of the polynomials a and
+// b (fewer if the product is shorter).
+template <typename mint_t, typename Alloc>
+std::vector<mint_t, Alloc> multiply_truncated(std::vector<mint_t, Alloc> a,
+                                              std::vector<mint_t, Alloc> b,
+                                              size_t truncate) {
+  if (a.size() > truncate) a.resize(truncate);
+  if (b.size() > truncate) b.resize(truncate);
+  if (a.empty() || b.empty()) return {};
+  const size_t product_size = a.size() + b.size() - 1;
+  const size_t fft_size = ceil_ntt_size(product_size);
+  const size_t a_size = a.size(), b_size = b.size();
+  a.resize(fft_size);
+  b.resize(fft_size);
+  ntt_bit_reversed_pruned(a, a_size);
+  ntt_bit_reversed_multiply(b, a, b_size);
+  const size_t result_size = std::min(truncate, product_size);
+  intt_bit_reversed_pruned(b, result_size);
+  b.resize(result_size);
+  return b;
+}
+
+// The product of the polynomials a and b.
+template <typename mint_t, typename Alloc>
+std::vector<mint_t, Alloc> convolve(std::vector<mint_t, Alloc> a,
+                                    std::vector<mint_t, Alloc> b) {
+  const size_t size = a.size() + b.size();
+  return multiply_truncated(std::move(a), std::move(b), size);
+}
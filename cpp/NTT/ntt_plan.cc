@@ -0,0 +1,173 @@
+#include "ntt_plan.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#include "../helpers/assertion.h"
+#include "../helpers/mod_int.h"
+
+namespace {
+
+template <typename mint_t>
+void fill_powers(mint_t* out, mint_t w, size_t count) {
+  mint_t cur = 1;
+  for (size_t i = 0; i < count; ++i, cur *= w) (out[i] = cur).normalize();
+}
+
+template <typename mint_t>
+mint_t get_cube_root() {
+  constexpr auto mod = mint_t::get_mod();
+  ASSERT_FATAL((mod - 1) % 3 == 0);  // The modulus has no such root.
+  for (mint_t res = 2;; ++res) {
+    auto root = res.pow((mod - 1) / 3);
+    if (root != 1) return root;
+  }
+}
+
+// The root of unity of order `size` (a power of two) that NttPlan uses.
+template <typename mint_t>
+mint_t get_power_of_2_root(size_t lg2_size) {
+  constexpr auto root_info = details::get_root<mint_t>();
+  auto [root, ord2] = root_info;
+  ASSERT_FATAL(lg2_size <= ord2);  // The modulus has no such root.
+  return root.pow(1ull << (ord2 - lg2_size));
+}
+}  // namespace
+
+template <typename mint_t>
+NttPlan<mint_t>::NttPlan(size_t size, size_t max_table_half)
+    : m_size(size), m_max_table_half(max_table_half) {
+  ASSERT_FATAL(size >= 1 && (size & (size - 1)) == 0);  // A power of two.
+  ASSERT_FATAL(max_table_half >= 1 &&
+               (max_table_half & (max_table_half - 1)) == 0);
+  m_lg2_size = __builtin_ctzll(size);
+
+  const mint_t root = get_power_of_2_root<mint_t>(m_lg2_size);
+
+  m_size_inverse = mint_t(size).inverse();
+  m_forward = fill(root);
+  m_inverse = fill(root.inverse());
+}
+
+template <typename mint_t>
+NttPlan<mint_t>::NttPlan(size_t size, const NttPlan& larger)
+    : m_size(size),
+      m_max_table_half(larger.m_max_table_half),
+      m_forward(larger.m_forward),
+      m_inverse(larger.m_inverse) {
+  ASSERT_FATAL(size >= 1 && (size & (size - 1)) == 0);  // A power of two.
+  ASSERT_FATAL(size <= larger.m_size);
+  m_lg2_size = __builtin_ctzll(size);
+  m_size_inverse = mint_t(size).inverse();
+}
+
+template <typename mint_t>
+auto NttPlan<mint_t>::fill(mint_t root) const
+    -> std::shared_ptr<const Direction> {
+  auto direction = std::make_shared<Direction>();
+  const size_t max_half = m_size / 2;
+  direction->table.resize(2 * std::min(max_half, m_max_table_half));
+  for (size_t half = 1; half <= max_half; half *= 2) {
+    const mint_t w = root.pow(m_size / (2 * half));
+    if (half <= m_max_table_half) {
+      fill_powers(direction->table.data() + half, w, half);
+    } else {
+      auto& fine =
+          direction->large_stages.emplace_back(half / m_max_table_half);
+      fill_powers(fine.data(), w, fine.size());
+    }
+  }
+  return direction;
+}
+
+template <typename mint_t>
+const mint_t* NttPlan<mint_t>::twiddles(size_t half, size_t k_start,
+                                        size_t count, bool inverse,
+                                        mint_t* buffer) const {
+  const auto& dir = direction(inverse);
+  if (half <= m_max_table_half) return dir.table.data() + half + k_start;
+
+  const size_t ratio = half / m_max_table_half;
+  const mint_t* coarse = dir.table.data() + m_max_table_half;
+  const mint_t* fine = dir.large_stages[__builtin_ctzll(ratio) - 1].data();
+  for (size_t i = 0; i < count; ++i) {
+    const size_t k = k_start + i;
+    (buffer[i] = coarse[k / ratio] * fine[k % ratio]).normalize();
+  }
+  return buffer;
+}
+
+template <typename mint_t>
+std::shared_ptr<const NttPlan<mint_t>> NttPlan<mint_t>::get(size_t size) {
+  static std::mutex mutex;
+  static std::map<size_t, std::shared_ptr<const NttPlan>> plans;
+  std::lock_guard lock(mutex);
+  if (auto it = plans.find(size); it != plans.end()) return it->second;
+  if (!plans.empty() && plans.rbegin()->first > size) {
+    const NttPlan& largest = *plans.rbegin()->second;
+    return plans[size] =
+               std::shared_ptr<const NttPlan>(new NttPlan(size, largest));
+  }
+  plans.clear();
+  return plans[size] = std::make_shared<const NttPlan>(size);
+}
+
+template <typename mint_t>
+Radix3Plan<mint_t>::Radix3Plan(size_t m) : m_m(m) {
+  ASSERT_FATAL(m >= 1 && (m & (m - 1)) == 0);  // A power of two.
+  // s^3 = root_m, and s has order m (the inverse of 3 modulo m is odd).
+  const size_t inverse_3 = (m % 3 == 2 ? m + 1 : 2 * m + 1) / 3;
+  const mint_t s =
+      get_power_of_2_root<mint_t>(__builtin_ctzll(m)).pow(inverse_3 % m);
+  // Has order 3 * m, and w^3 = s^3.
+  const mint_t w = s * get_cube_root<mint_t>();
+  fill(m_forward, w, 1);
+  fill(m_inverse, w.inverse(), mint_t(3).inverse());
+}
+
+template <typename mint_t>
+void Radix3Plan<mint_t>::fill(Direction& direction, mint_t w, mint_t scale) {
+  (direction.omega = w.pow(m_m)).normalize();
+  (direction.scale = scale).normalize();
+  // Balances the sizes of the tables.
+  const size_t fine_size = 1ull << (__builtin_ctzll(m_m) + 1) / 2;
+  direction.fine.resize(fine_size);
+  direction.coarse.resize(m_m / fine_size);
+  fill_powers(direction.fine.data(), w, fine_size);
+  fill_powers(direction.coarse.data(), w.pow(fine_size), m_m / fine_size);
+}
+
+template <typename mint_t>
+void Radix3Plan<mint_t>::twiddles(size_t k_start, size_t count, bool inverse,
+                                  mint_t* out1, mint_t* out2) const {
+  const auto& dir = direction(inverse);
+  const size_t fine_size = dir.fine.size();
+  for (size_t i = 0; i < count; ++i) {
+    const size_t k = k_start + i;
+    const mint_t w_k = dir.coarse[k / fine_size] * dir.fine[k % fine_size];
+    (out1[i] = w_k * dir.scale).normalize();
+    (out2[i] = w_k * out1[i]).normalize();
+  }
+}
+
+template <typename mint_t>
+std::shared_ptr<const Radix3Plan<mint_t>> Radix3Plan<mint_t>::get(size_t m) {
+  static std::mutex mutex;
+  static std::map<size_t, std::shared_ptr<const Radix3Plan>> plans;
+  std::lock_guard lock(mutex);
+  auto& plan = plans[m];
+  if (!plan) plan = std::make_shared<const Radix3Plan>(m);
+  return plan;
+}
+
+template class NttPlan<mint>;
+template class NttPlan<mint2>;
+template class NttPlan<mint3>;
+template class NttPlan<mint32>;
+template class NttPlan<mint32_2>;
+template class Radix3Plan<mint>;
+template class Radix3Plan<mint2>;
+template class Radix3Plan<mint3>;
+template class Radix3Plan<mint32>;
+template class Radix3Plan<mint32_2>;
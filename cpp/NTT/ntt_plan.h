@@ -0,0 +1,132 @@
+#pragma once
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../helpers/aligned_vector.h"
+
+namespace details {
+// A root of unity of order 2^ord2, the largest power of two dividing MOD - 1.
+// Returns {root, ord2}.
+template <typename mint_t>
+consteval std::pair<mint_t, size_t> get_root() {
+  auto mod = mint_t::get_mod();
+  auto ord = mod - 1;
+  decltype(ord) part2 = 1;
+  size_t ord2 = 0;
+  while ((ord % 2) == 0) {
+    part2 *= 2;
+    ord /= 2;
+    ++ord2;
+  }
+
+  for (mint_t res = 2;; ++res) {
+    auto res1 = res.pow(ord);
+    if (res1.pow(part2 / 2) != 1) {
+      return {res1, ord2};
+    }
+  }
+}
+}  // namespace details
+
+/**
+ * Everything the NTT of a given size needs that does not depend on the data:
+ * The twiddles (w_b^k for a block of size b, and k < b/2) of every stage, for
+ * both directions, and the scaling of the inverse transform.
+ *
+ * The twiddles of stages with half block up to `max_table_half` are stored
+ * contiguously, so the butterflies only load them. For larger stages we write
+ * k = q * (half / max_table_half) + r and keep w_b^r, so that each twiddle is
+ * a single multiplication: w_b^k = w_{2 * max_table_half}^q * w_b^r.
+ *
+ * The twiddles of a stage do not depend on the size, so the cached plans
+ * (see `get`) share the tables of the largest one.
+ * Plans are immutable, use `get` to share them between calls.
+ * Instantiated for the NttModInts (see helpers/moduli.h).
+ */
+template <typename mint_t>
+class NttPlan {
+ public:
+  static constexpr size_t default_max_table_half = 1ull << 22;
+
+  explicit NttPlan(size_t size,
+                   size_t max_table_half = default_max_table_half);
+
+  // Returns the (cached) plan for the given size, with the default
+  // max_table_half. A plan larger than the cached ones replaces them (they
+  // are rebuilt on their next use, over its tables).
+  static std::shared_ptr<const NttPlan> get(size_t size);
+
+  size_t size() const { return m_size; }
+  size_t lg2_size() const { return m_lg2_size; }
+  // 1 / size, the scaling of the inverse transform.
+  const mint_t& size_inverse() const { return m_size_inverse; }
+
+  // Returns w^k for k in [k_start, k_start + count), where w is the root of
+  // unity of the stage with the given half block (inverted if `inverse`).
+  // The twiddles are normalized (see ModInt::normalize).
+  // Points into the table if possible, otherwise computes into `buffer`.
+  const mint_t* twiddles(size_t half, size_t k_start, size_t count,
+                         bool inverse, mint_t* buffer) const;
+
+ private:
+  struct Direction {
+    // [half + k] = w_{2 * half}^k, for half <= max_table_half.
+    aligned_vector<mint_t> table;
+    // [lg2(half / max_table_half)][r] = w_{2 * half}^r for larger stages.
+    std::vector<aligned_vector<mint_t>> large_stages;
+  };
+  // The plan of `size` over the tables of `larger`.
+  NttPlan(size_t size, const NttPlan& larger);
+
+  const Direction& direction(bool inverse) const {
+    return inverse ? *m_inverse : *m_forward;
+  }
+  std::shared_ptr<const Direction> fill(mint_t root) const;
+
+  size_t m_size, m_lg2_size, m_max_table_half;
+  mint_t m_size_inverse;
+  std::shared_ptr<const Direction> m_forward, m_inverse;
+};
+
+/**
+ * The radix-3 step of the transforms of size 3 * m (m a power of two): w is a
+ * root of unity of order 3 * m whose cube is the root of NttPlan(m), and
+ * omega = w^m is a cube root of unity.
+ * w^k for k < m is stored as coarse[k / fine_size] * fine[k % fine_size].
+ * Instantiated for the NttModInts (see helpers/moduli.h).
+ */
+template <typename mint_t>
+class Radix3Plan {
+ public:
+  explicit Radix3Plan(size_t m);
+
+  // Returns the (cached) plan for the given m.
+  static std::shared_ptr<const Radix3Plan> get(size_t m);
+
+  size_t m() const { return m_m; }
+  // omega (inverted if `inverse`), normalized.
+  const mint_t& omega(bool inverse) const {
+    return direction(inverse).omega;
+  }
+  // The scaling of the inverse step (1/3), or 1. Normalized.
+  const mint_t& scale(bool inverse) const { return direction(inverse).scale; }
+
+  // Writes scale * w^k to out1 and scale * w^(2k) to out2, for k in
+  // [k_start, k_start + count) (w inverted if `inverse`). Normalized.
+  void twiddles(size_t k_start, size_t count, bool inverse, mint_t* out1,
+                mint_t* out2) const;
+
+ private:
+  struct Direction {
+    mint_t omega, scale;
+    aligned_vector<mint_t> coarse, fine;
+  };
+  const Direction& direction(bool inverse) const {
+    return inverse ? m_inverse : m_forward;
+  }
+  void fill(Direction& direction, mint_t w, mint_t scale);
+
+  size_t m_m;
+  Direction m_forward, m_inverse;
+};
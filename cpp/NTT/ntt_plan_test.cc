@@ -0,0 +1,85 @@
+#include "ntt_plan.h"
+
+#include <gtest/gtest.h>
+
+#include "../helpers/mod_int.h"
+
+TEST(ntt_plan, twiddles) {
+  constexpr size_t n = 1ull << 8;
+  // A small table, so the large stages are computed as well.
+  for (size_t max_table_half : {size_t(1), size_t(4), n}) {
+    NttPlan<mint> plan(n, max_table_half);
+    EXPECT_EQ(plan.size_inverse() * n, 1);
+    for (bool inverse : {false, true}) {
+      for (size_t half = 1; half < n; half *= 2) {
+        std::vector<mint> buffer(half);
+        const mint* w = plan.twiddles(half, 0, half, inverse, buffer.data());
+        EXPECT_EQ(w[0], 1);
+        if (half == 1) continue;
+        // w[1] is a primitive root of order 2 * half.
+        EXPECT_EQ(w[1].pow(half), -1);
+        for (size_t k = 1; k < half; ++k) ASSERT_EQ(w[k], w[1].pow(k));
+
+        mint single;
+        EXPECT_EQ(*plan.twiddles(half, half - 1, 1, inverse, &single),
+                  w[half - 1]);
+        if (inverse) {
+          EXPECT_EQ(w[1] * *plan.twiddles(half, 1, 1, false, &single), 1);
+        }
+      }
+    }
+  }
+}
+
+TEST(ntt_plan, cached) {
+  EXPECT_EQ(NttPlan<mint>::get(1ull << 10), NttPlan<mint>::get(1ull << 10));
+  EXPECT_EQ(NttPlan<mint2>::get(1ull << 10)->size(), 1ull << 10);
+  EXPECT_ANY_THROW(NttPlan<mint>(3));
+}
+
+TEST(ntt_plan, radix3) {
+  for (size_t m : {size_t(1), size_t(2), size_t(1) << 9}) {
+    Radix3Plan<mint> plan(m);
+    const mint omega = plan.omega(false);
+    EXPECT_NE(omega, 1);
+    EXPECT_EQ(omega.pow(3), 1);
+    EXPECT_EQ(omega * plan.omega(true), 1);
+    EXPECT_EQ(plan.scale(true) * 3, 1);
+    std::vector<mint> t1(m), t2(m), inv1(m), inv2(m);
+    plan.twiddles(0, m, false, t1.data(), t2.data());
+    plan.twiddles(0, m, true, inv1.data(), inv2.data());
+    const mint w = m > 1 ? t1[1] : omega;
+    // w has order 3 * m, and w^3 is the root of the power of two stages.
+    EXPECT_EQ(w.pow(m), omega);
+    if (m > 2) {
+      NttPlan<mint> power_of_2_plan(m);
+      EXPECT_EQ(w.pow(3),
+                *power_of_2_plan.twiddles(m / 2, 1, 1, false, nullptr));
+    }
+    for (size_t k = 0; k < m; ++k) {
+      ASSERT_EQ(t1[k], w.pow(k));
+      ASSERT_EQ(t2[k], w.pow(2 * k));
+      ASSERT_EQ(inv1[k] * t1[k] * 3, 1);
+      ASSERT_EQ(inv2[k] * t2[k] * 3, 1);
+    }
+  }
+}
+
+TEST(ntt_plan, shared_tables) {
+  // The smaller plans point into the tables of the largest one.
+  auto large = NttPlan<mint32>::get(1ull << 12);
+  auto small = NttPlan<mint32>::get(1ull << 6);
+  for (bool inverse : {false, true}) {
+    EXPECT_EQ(small->twiddles(8, 0, 8, inverse, nullptr),
+              large->twiddles(8, 0, 8, inverse, nullptr));
+  }
+  // And match a plan of their own.
+  NttPlan<mint32> own(1ull << 6);
+  for (size_t half = 1; half < 64; half *= 2) {
+    for (size_t k = 0; k < half; ++k) {
+      ASSERT_EQ(*small->twiddles(half, k, 1, true, nullptr),
+                *own.twiddles(half, k, 1, true, nullptr));
+    }
+  }
+  EXPECT_EQ(small->size_inverse() * 64, 1);
+}
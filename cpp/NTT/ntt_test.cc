@@ -4,10 +4,16 @@
 
 #include <memory>
 #include <numeric>
+#include <random>
+#include <tuple>
 
 #include "../conv/naive_conv.h"
 #include "../helpers/benchmark.h"
 #include "../helpers/mod_int.h"
+#include "../helpers/parallel.h"
+#include "../helpers/tuning.h"
+#include "../mobius/bit_reverse.h"
+#include "ntt_plan.h"
 
 using NT = std::vector<mint>;
 TEST(NTT, test_conv) {
@@ -61,4 +67,264 @@ TEST(benchmark, ntt_conv) {
         return std::accumulate(a.begin(), a.end(), mint(0));
       },
       15);
-}
\ No newline at end of file
+}
+TEST(NTT, test_parallel) {
+  NT a(1ull << 18);
+  std::iota(a.begin(), a.end(), 1);
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(1);
+  auto expected = a;
+  ntt(expected);
+  for (size_t threads : {2, 3, 8}) {
+    parallel::set_num_threads(threads);
+    auto res = a;
+    ntt(res);
+    EXPECT_EQ(res, expected);
+    intt(res);
+    EXPECT_EQ(res, a);
+  }
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(NTT, test_six_step) {
+  // Large enough for the six-step order.
+  constexpr size_t n = 1ull << 23;
+  NT a(n);
+  std::mt19937_64 rng(1);
+  for (auto &i : a) i = rng();
+  auto res = a;
+  ntt(res);
+  const mint w = *NttPlan<mint>::get(n)->twiddles(n / 2, 1, 1, false, nullptr);
+  for (size_t k : {size_t(0), size_t(1), size_t(12345), n - 1}) {
+    mint expected = 0, w_k = w.pow(k), cur = 1;
+    for (size_t i = 0; i < n; ++i, cur *= w_k) expected += a[i] * cur;
+    EXPECT_EQ(res[k], expected) << k;
+  }
+  intt(res);
+  EXPECT_EQ(res, a);
+}
+
+TEST(NTT, test_bit_reversed) {
+  // Both the regular and the six-step orders.
+  for (size_t n : {size_t(1), size_t(2), size_t(8), size_t(1) << 11,
+                   size_t(1) << 22}) {
+    NT a(n);
+    std::mt19937_64 rng(n);
+    for (auto &i : a) i = rng();
+    auto expected = a;
+    ntt(expected);
+    auto res = a;
+    ntt_bit_reversed(res);
+    for (size_t k = 0; k < n; ++k) {
+      ASSERT_EQ(res[bit_reverse(k, n)], expected[k]) << n << " " << k;
+    }
+    intt_bit_reversed(res);
+    EXPECT_EQ(res, a) << n;
+  }
+}
+
+TEST(NTT, test_pruned) {
+  for (auto [n, m] : {std::pair<size_t, size_t>(1, 1), {8, 0}, {8, 3},
+                      {1 << 11, 1 << 9}, {1 << 11, 1000}, {1 << 11, 2047},
+                      {1 << 23, (1 << 22) - 5}}) {
+    NT a(n);
+    std::mt19937_64 rng(n + m);
+    for (size_t i = 0; i < m; ++i) a[i] = rng();
+    auto expected = a;
+    ntt_bit_reversed(expected);
+    auto res = a;
+    ntt_bit_reversed_pruned(res, m);
+    ASSERT_EQ(res, expected) << n << " " << m;
+    intt_bit_reversed_pruned(res, m);
+    for (size_t i = 0; i < m; ++i) ASSERT_EQ(res[i], a[i]) << n << " " << i;
+  }
+}
+
+TEST(NTT, test_tuning_params) {
+  const tuning::Params initial = tuning::get();
+  for (size_t n : {size_t(1) << 11, size_t(1) << 22}) {
+    NT a(n);
+    std::iota(a.begin(), a.end(), 1);
+    auto expected = a;
+    ntt(expected);
+    for (auto [chunk, blocks, lg2_chunk] :
+         {std::tuple<size_t, size_t, size_t>(1, 1, 2), {8, 16, 4},
+          {64, 64, 5}}) {
+      tuning::set({chunk, blocks, lg2_chunk});
+      auto res = a;
+      ntt(res);
+      EXPECT_EQ(res, expected) << n << " " << chunk << " " << blocks;
+      auto padded = a;
+      std::fill(padded.begin() + n / 2 - 3, padded.end(), 0);
+      ntt_bit_reversed_pruned(res = padded, n / 2 - 3);
+      intt_bit_reversed(res);
+      EXPECT_EQ(res, padded) << n << " " << chunk << " " << blocks;
+    }
+  }
+  tuning::set(initial);
+}
+
+TEST(NTT, test_sizes) {
+  EXPECT_TRUE(is_ntt_size(1));
+  EXPECT_TRUE(is_ntt_size(3 << 5));
+  EXPECT_FALSE(is_ntt_size(9));
+  EXPECT_FALSE(is_ntt_size(0));
+  EXPECT_EQ(ceil_ntt_size(1), 1);
+  EXPECT_EQ(ceil_ntt_size(3), 3);
+  EXPECT_EQ(ceil_ntt_size(5), 6);
+  EXPECT_EQ(ceil_ntt_size(7), 8);
+  EXPECT_EQ(ceil_ntt_size(1025), 1536);
+  EXPECT_EQ(ceil_ntt_size(1537), 2048);
+  for (size_t n : {size_t(8), size_t(3), size_t(3) << 4}) {
+    for (size_t k = 0; k < n; ++k) {
+      ASSERT_EQ(bit_reversed_frequency(bit_reversed_position(k, n), n), k);
+    }
+  }
+}
+
+template <typename mint_t>
+void test_mixed_radix(size_t n) {
+  using V = std::vector<mint_t>;
+  V a(n);
+  std::mt19937_64 rng(n);
+  for (auto &i : a) i = rng();
+  // The root of the transform: ntt({0, 1, 0, ...})[k] = w^k.
+  V delta(n);
+  delta[1] = 1;
+  ntt(delta);
+  const mint_t w = delta[1];
+  EXPECT_EQ(w.pow(n), 1);
+  EXPECT_NE(w.pow(n / 3), 1);
+  if (n % 2 == 0) {
+    EXPECT_NE(w.pow(n / 2), 1);
+  }
+
+  auto res = a;
+  ntt(res);
+  // A few frequencies (the bit reversed order checks them all against res).
+  for (size_t k : {size_t(0), size_t(1), n / 3, n / 2 + 1, n - 1}) {
+    mint_t expected = 0, w_k = w.pow(k), cur = 1;
+    for (size_t i = 0; i < n; ++i, cur *= w_k) expected += a[i] * cur;
+    ASSERT_EQ(res[k], expected) << n << " " << k;
+  }
+  auto bit_reversed = a;
+  ntt_bit_reversed(bit_reversed);
+  for (size_t k = 0; k < n; ++k) {
+    ASSERT_EQ(bit_reversed[bit_reversed_position(k, n)], res[k])
+        << n << " " << k;
+  }
+  intt(res);
+  EXPECT_EQ(res, a) << n;
+  intt_bit_reversed(bit_reversed);
+  EXPECT_EQ(bit_reversed, a) << n;
+}
+
+TEST(NTT, test_mixed_radix) {
+  // Also several blocks of the in-place permutation to the bit reversed order.
+  for (size_t n : {3, 6, 12, 48, 3 << 10, 3 << 13}) test_mixed_radix<mint>(n);
+  test_mixed_radix<mint2>(3 << 5);
+  test_mixed_radix<mint3>(3 << 5);
+  test_mixed_radix<mint32>(3 << 5);
+  test_mixed_radix<mint32_2>(3 << 5);
+  // The thirds use the six-step order.
+  test_mixed_radix<mint32>(3 << 22);
+}
+
+TEST(NTT, test_mixed_radix_pruned) {
+  constexpr size_t n = 3 << 10;
+  for (size_t m : {0, 100, 1024, 2000, 3072}) {
+    NT a(n);
+    std::mt19937_64 rng(m);
+    for (size_t i = 0; i < m; ++i) a[i] = rng();
+    auto expected = a;
+    ntt_bit_reversed(expected);
+    auto res = a;
+    ntt_bit_reversed_pruned(res, m);
+    ASSERT_EQ(res, expected) << m;
+    intt_bit_reversed_pruned(res, m);
+    for (size_t i = 0; i < m; ++i) ASSERT_EQ(res[i], a[i]) << m << " " << i;
+  }
+}
+
+TEST(NTT, test_mixed_radix_conv) {
+  NT a(12), b(12);
+  for (size_t i = 0; i < 6; ++i) a[i] = i + 1, b[i] = 2 * i + 3;
+  NT expected(12);
+  for (size_t i = 0; i < 6; ++i)
+    for (size_t j = 0; j < 6; ++j) expected[i + j] += a[i] * b[j];
+  ntt_bit_reversed(a), ntt_bit_reversed(b);
+  for (size_t i = 0; i < 12; ++i) a[i] *= b[i];
+  intt_bit_reversed(a);
+  EXPECT_EQ(a, expected);
+}
+
+TEST(NTT, test_small_sizes) {
+  // Sizes where the codelets apply all (or most) of the stages.
+  for (size_t n = 1; n <= 64; n *= 2) {
+    NT a(n);
+    std::mt19937_64 rng(n);
+    for (auto &i : a) i = rng();
+    NT delta(n);
+    delta[n > 1] = 1;
+    ntt(delta);
+    const mint w = delta[n > 1];
+    EXPECT_EQ(w.pow(n), 1);
+    if (n > 1) {
+      EXPECT_NE(w.pow(n / 2), 1);
+    }
+    auto res = a;
+    ntt(res);
+    for (size_t k = 0; k < n; ++k) {
+      mint expected = 0, w_k = w.pow(k), cur = 1;
+      for (size_t i = 0; i < n; ++i, cur *= w_k) expected += a[i] * cur;
+      ASSERT_EQ(res[k], expected) << n << " " << k;
+    }
+    auto bit_reversed = a;
+    ntt_bit_reversed(bit_reversed);
+    intt(res);
+    EXPECT_EQ(res, a) << n;
+    intt_bit_reversed(bit_reversed);
+    EXPECT_EQ(bit_reversed, a) << n;
+  }
+}
+
+TEST(NTT, test_fused_multiply) {
+  std::mt19937_64 rng(1);
+  for (size_t n : {size_t(1), size_t(5), size_t(100), size_t(3000)}) {
+    NT a(n), b(n / 2 + 1);
+    for (auto &i : a) i = rng();
+    for (auto &i : b) i = rng();
+    const auto expected = naive_conv(a, b);
+    EXPECT_EQ(convolve(a, b), expected) << n;
+    for (size_t truncate : {size_t(1), n / 3 + 1, n, 2 * n}) {
+      auto truncated = expected;
+      truncated.resize(std::min(truncate, expected.size()));
+      EXPECT_EQ(multiply_truncated(a, b, truncate), truncated) << n;
+    }
+  }
+  // Both directions against the separate product, and the six-step order.
+  for (size_t n : {size_t(3) << 4, size_t(1) << 10, size_t(1) << 22}) {
+    NT a(n), b(n);
+    for (auto &i : a) i = rng();
+    for (auto &i : b) i = rng();
+    ntt_bit_reversed(b);
+    for (size_t nonzero_size : {size_t(1), n / 2, n}) {
+      auto zero_padded = a;
+      std::fill(zero_padded.begin() + nonzero_size, zero_padded.end(), 0);
+      auto expected = zero_padded;
+      ntt_bit_reversed(expected);
+      for (size_t i = 0; i < n; ++i) expected[i] *= b[i];
+      auto res = zero_padded;
+      ntt_bit_reversed_multiply(res, b, nonzero_size);
+      EXPECT_EQ(res, expected) << n << " " << nonzero_size;
+      auto product = zero_padded;
+      for (size_t i = 0; i < n; ++i) product[i] *= b[i];
+      intt_bit_reversed(product);
+      res = zero_padded;
+      intt_bit_reversed_multiply(res, b, nonzero_size);
+      res.resize(nonzero_size);
+      product.resize(nonzero_size);
+      EXPECT_EQ(res, product) << n << " " << nonzero_size;
+    }
+  }
+}
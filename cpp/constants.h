@@ -1,3 +1,13 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 constexpr uint64_t MOD = 3221225473ull;  // 2^30 sub-group
+
+// Extra NTT friendly moduli, used to get the exact count using the CRT.
+constexpr uint64_t MOD2 = 2013265921ull;  // 15 * 2^27 + 1
+constexpr uint64_t MOD3 = 1811939329ull;  // 27 * 2^26 + 1
+
+// 32-bit moduli (ModInt32 needs MOD < 2^30), for the transforms up to their
+// maximal sizes: Half the memory, and twice the SIMD lanes.
+constexpr uint64_t MOD32 = 754974721ull;    // 45 * 2^24 + 1
+constexpr uint64_t MOD32_2 = 880803841ull;  // 105 * 2^23 + 1
@@ -1,22 +1,31 @@
 #include "count_primes.h"
 
 #include <array>
+#include <cmath>
 #include <vector>
 
+#include "../constants.h"
+#include "../helpers/assertion.h"
 #include "../helpers/cell.h"
+#include "../helpers/double_int.h"
+#include "../helpers/math.h"
+#include "../helpers/moduli.h"
 #include "../helpers/mod_int.h"
+#include "../helpers/parallel.h"
 #include "../helpers/sieve_primes.h"
 #include "../helpers/types.h"
+#include "../mobius/mobius_cache.h"
 #include "../mobius/mobius_using_newton.h"
 #include "error_correction.h"
 #include "logarithmic_integral.h"
 
-mint count_primes_with_errors(prime_t upto, double lg2_prec,
-                              prime_t max_prime_to_use) {
+template <typename mint_t>
+mint_t count_primes_with_errors(prime_t upto, double lg2_prec,
+                                prime_t max_prime_to_use) {
   size_t num_small_primes = get_primes_by_sieve(max_prime_to_use).size();
   // Mobius only of numbers with factors are up to max_prime_to_use.
-  auto mobius = get_mobius_using_newton(upto, lg2_prec,
-                                        /*max_prime=*/max_prime_to_use);
+  auto mobius = mobius_cache::get_mobius<mint_t>(
+      upto, lg2_prec, /*max_prime=*/max_prime_to_use);
 
   auto get_cumsum_all_numbers = [lg2_prec](size_t cell) {
     return get_cell_end(cell, lg2_prec);
@@ -28,7 +37,7 @@ mint count_primes_with_errors(prime_t upto, double lg2_prec,
    * all_numbers upto index `max_cell - i`.
    */
   size_t max_cell = get_cell(upto, lg2_prec);
-  mint estimated_num_large_primes = 0;  // Larger than `max_prime_to_use`
+  mint_t estimated_num_large_primes = 0;  // Larger than `max_prime_to_use`
   {
     // Bone*Mobius
     size_t i = 0;
@@ -69,6 +78,12 @@ mint count_primes_with_errors(prime_t upto, double lg2_prec,
   return estimated_num_large_primes + num_small_primes - 1;
 }
 
+template mint count_primes_with_errors(prime_t, double, prime_t);
+template mint2 count_primes_with_errors(prime_t, double, prime_t);
+template mint3 count_primes_with_errors(prime_t, double, prime_t);
+template mint32 count_primes_with_errors(prime_t, double, prime_t);
+template mint32_2 count_primes_with_errors(prime_t, double, prime_t);
+
 namespace {
 prime_t get_closest(prime_t v, std::array<prime_t, 3> candidates) {
   prime_t ans = candidates[0];
@@ -78,20 +93,103 @@ prime_t get_closest(prime_t v, std::array<prime_t, 3> candidates) {
   return ans;
 }
 
-prime_t lift_to_integer_using_li(mint prime_count, prime_t upto) {
+prime_t lift_to_integer_using_li(uint64_t prime_count, uint64_t mod,
+                                 prime_t upto) {
   // Assuming the Riemann Hypothesis, we can deduce the top bits of the result
   // using the logarithm integral.
   prime_t estimation = std::round(li(upto));
-  prime_t v = prime_count.get();
-  prime_t mod = mint::get_mod();
-  prime_t est_mod = estimation - (estimation % mod);
+  prime_t v = prime_count;
+  prime_t est_mod = estimation - (estimation % prime_t(mod));
   return get_closest(estimation,
-                     {est_mod - mod + v, est_mod + v, est_mod + mod + v});
+                     {est_mod - prime_t(mod) + v, est_mod + v,
+                      est_mod + prime_t(mod) + v});
+}
+
+bool can_lift_using_li(prime_t upto, uint64_t mod) {
+  // Assuming the Riemann Hypothesis, |pi(x) - li(x)| < sqrt(x) * ln(x) / 8pi
+  // (Schoenfeld). We leave a margin for the numeric errors of `li`.
+  double error_bound = std::sqrt(upto) * std::log(upto) / (8 * M_PI);
+  return upto < 2657 || error_bound < mod / 4.;
+}
+
+// The moduli whose transforms are large enough for `upto`, cheapest first.
+std::vector<uint64_t> get_usable_moduli(prime_t upto, double lg2_prec) {
+  const size_t ntt_size = get_mobius_ntt_size(upto, lg2_prec);
+  const size_t lg2_size = __builtin_ctzll(ntt_size % 3 == 0 ? ntt_size / 3
+                                                             : ntt_size);
+  std::vector<uint64_t> res;
+  for (uint64_t mod : ntt_moduli) {
+    if (lg2_size <= max_ntt_lg2_size(mod)) res.push_back(mod);
+  }
+  ASSERT_FATAL(!res.empty());  // Too large for all the moduli.
+  return res;
+}
+
+size_t num_moduli_for_exact_count(prime_t upto,
+                                  const std::vector<uint64_t>& moduli) {
+  __int128_t moduli_prod = 1;
+  size_t num_moduli = 0;
+  while (moduli_prod <= upto) {
+    ASSERT_FATAL(num_moduli < moduli.size());
+    moduli_prod *= moduli[num_moduli++];
+  }
+  return num_moduli;
+}
+
+// Returns the count of primes modulo `mod` (one of ntt_moduli).
+uint64_t count_primes_modulo(uint64_t mod, prime_t upto, double lg2_prec,
+                             prime_t max_prime_to_use, prime_t error) {
+  return dispatch_modulus(mod, [&]<typename mint_t>() -> uint64_t {
+    auto res = count_primes_with_errors<mint_t>(upto, lg2_prec,
+                                                max_prime_to_use);
+    return (res - error).get();
+  });
+}
+
+// Returns the x in [0, prod(moduli)) with x = residues[i] (mod moduli[i]).
+__int128_t chinese_remainder(const std::vector<uint64_t>& residues,
+                             const std::vector<uint64_t>& moduli) {
+  __int128_t res = 0, moduli_prod = 1;
+  for (size_t i = 0; i < residues.size(); ++i) {
+    uint64_t mod = moduli[i];
+    uint64_t prod_inv = pow_mod<uint64_t>(moduli_prod % mod, mod - 2, mod);
+    uint64_t diff = (residues[i] + mod - uint64_t(res % mod)) % mod;
+    res += moduli_prod * wide_mul<uint64_t>(diff, prod_inv) % mod;
+    moduli_prod *= mod;
+  }
+  return res;
 }
 }  // namespace
 
+prime_t count_primes_using_crt(prime_t upto, double lg2_prec,
+                               prime_t max_prime_to_use,
+                               std::optional<size_t> num_moduli) {
+  auto moduli = get_usable_moduli(upto, lg2_prec);
+  size_t min_num_moduli = num_moduli_for_exact_count(upto, moduli);
+  if (!num_moduli.has_value()) num_moduli = min_num_moduli;
+  ASSERT_FATAL(min_num_moduli <= num_moduli.value());
+  ASSERT_FATAL(num_moduli.value() <= moduli.size());
+  moduli.resize(num_moduli.value());
+
+  prime_t error = error_correction(upto, lg2_prec, max_prime_to_use);
+  std::vector<uint64_t> residues(moduli.size());
+  // The moduli are independent, compute them concurrently.
+  parallel::parallel_for(residues.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      residues[i] = count_primes_modulo(moduli[i], upto, lg2_prec,
+                                        max_prime_to_use, error);
+    }
+  });
+  return chinese_remainder(residues, moduli);
+}
+
 prime_t count_primes(prime_t upto, double lg2_prec, prime_t max_prime_to_use) {
-  mint ans = count_primes_with_errors(upto, lg2_prec, max_prime_to_use);
-  ans -= error_correction(upto, lg2_prec, max_prime_to_use);
-  return lift_to_integer_using_li(ans, upto);
+  for (uint64_t mod : get_usable_moduli(upto, lg2_prec)) {
+    if (!can_lift_using_li(upto, mod)) continue;
+    prime_t error = error_correction(upto, lg2_prec, max_prime_to_use);
+    uint64_t count = count_primes_modulo(mod, upto, lg2_prec,
+                                         max_prime_to_use, error);
+    return lift_to_integer_using_li(count, mod, upto);
+  }
+  return count_primes_using_crt(upto, lg2_prec, max_prime_to_use);
 }
\ No newline at end of file
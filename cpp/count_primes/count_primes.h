@@ -1,12 +1,28 @@
 #pragma once
 #include <cmath>
+#include <optional>
 
 #include "../helpers/mod_int.h"
 #include "../helpers/types.h"
 
-mint count_primes_with_errors(prime_t upto, double lg2_prec,
-                              prime_t max_prime_to_use);
+// Instantiated for the NttModInts (see helpers/moduli.h).
+template <typename mint_t = mint>
+mint_t count_primes_with_errors(prime_t upto, double lg2_prec,
+                                prime_t max_prime_to_use);
 
+// Computes the count modulo several NTT friendly primes (concurrently), and
+// combines them using the CRT. Does not rely on the Riemann Hypothesis.
+// Uses the cheapest of ntt_moduli (see helpers/moduli.h) whose transforms are
+// large enough, by default the least number of them needed for an exact
+// answer.
+prime_t count_primes_using_crt(
+    prime_t upto, double lg2_prec, prime_t max_prime_to_use,
+    std::optional<size_t> num_moduli = std::nullopt);
+
+// Lifts the count modulo a single prime using the logarithmic integral while
+// the error bound (assuming RH) allows it, and falls back to the CRT
+// otherwise. Picks the cheapest modulus that works (see
+// count_primes_using_crt).
 prime_t count_primes(prime_t upto, double lg2_prec, prime_t max_prime_to_use);
 
 inline prime_t count_primes(prime_t upto) {
@@ -82,4 +82,16 @@ TEST(correctness_test, count_primes) {
       EXPECT_EQ(ans_from_web[power], computed_num_primes);
     }
   }
-}
\ No newline at end of file
+}
+TEST(correctness_test, count_primes_using_crt) {
+  for (prime_t upto : {10, 1000, 1'000'000}) {
+    prime_t num_primes = get_primes_by_sieve(upto).size();
+    double lg2_prec = 1. / std::sqrt(upto);
+    prime_t use_primes_upto = std::ceil(std::sqrt(upto));
+    for (size_t num_moduli : {1, 2, 3}) {
+      EXPECT_EQ(num_primes, count_primes_using_crt(upto, lg2_prec,
+                                                   use_primes_upto, num_moduli))
+          << upto << " " << num_moduli;
+    }
+  }
+}
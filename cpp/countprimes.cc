@@ -2,13 +2,31 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <string>
 
+#include "NTT/autotune.h"
 #include "count_primes/count_primes.h"
+#include "helpers/mapped_vector.h"
+#include "helpers/parallel.h"
+#include "helpers/tuning.h"
 #include "helpers/types.h"
 
 int main(int argc, char* argv[]) {
-  if (argc < 2 || argc > 3) {
-    std::cerr << "Usage: countprimes UPTO [MEMORY_TRADEOFF]" << std::endl;
+  if (argc >= 2 && argv[1] == std::string("--tune")) {
+    if (argc > 3) {
+      std::cerr << "Usage: countprimes --tune [CONFIG_FILE]" << std::endl;
+      return -1;
+    }
+    const std::string path = argc == 3 ? argv[2] : tuning::default_path();
+    tuning::save(autotune(std::cout), path);
+    std::cout << "Saved to " << path << std::endl;
+    return 0;
+  }
+  if (argc < 2 || argc > 6) {
+    std::cerr << "Usage: countprimes UPTO [MEMORY_TRADEOFF] [NUM_THREADS] "
+                 "[STORAGE_DIR] [MEMORY_BUDGET_GB]"
+              << std::endl
+              << "       countprimes --tune [CONFIG_FILE]" << std::endl;
     return -1;
   }
   long double upto_;
@@ -21,7 +39,7 @@ int main(int argc, char* argv[]) {
   }
   std::cout << upto << std::endl;
   double memory_tradeoff = 1.;
-  if (argc == 3) {
+  if (argc >= 3) {
     std::stringstream s2(argv[2]);
     s2 >> memory_tradeoff;
     if (s2.fail() || memory_tradeoff < 0) {
@@ -29,6 +47,27 @@ int main(int argc, char* argv[]) {
       return -1;
     }
   }
+  if (argc >= 4) {
+    std::stringstream s3(argv[3]);
+    size_t num_threads;
+    s3 >> num_threads;
+    if (s3.fail() || num_threads == 0) {
+      std::cout << "Could not parse third argument." << std::endl;
+      return -1;
+    }
+    parallel::set_num_threads(num_threads);
+  }
+  if (argc >= 5) storage::set_dir(argv[4]);
+  if (argc == 6) {
+    std::stringstream s5(argv[5]);
+    double memory_budget_gb;
+    s5 >> memory_budget_gb;
+    if (s5.fail() || memory_budget_gb < 0) {
+      std::cout << "Could not parse fifth argument." << std::endl;
+      return -1;
+    }
+    storage::set_memory_budget(memory_budget_gb * (1ull << 30));
+  }
   double lg2_prec = 1. / std::sqrt(upto) * memory_tradeoff;
   prime_t max_prime_to_use = std::ceil(std::sqrt(upto));
 
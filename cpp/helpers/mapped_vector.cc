@@ -0,0 +1,46 @@
+#include "mapped_vector.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+#include "assertion.h"
+
+namespace {
+std::string dir_;
+size_t memory_budget_ = 0;
+}  // namespace
+
+void storage::set_dir(const std::string& dir) { dir_ = dir; }
+
+const std::string& storage::get_dir() { return dir_; }
+
+bool storage::out_of_core() { return !dir_.empty(); }
+
+void storage::set_memory_budget(size_t bytes) { memory_budget_ = bytes; }
+
+size_t storage::get_memory_budget() { return memory_budget_; }
+
+void* storage::details::map(size_t bytes) {
+  if (!out_of_core()) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_FATAL(p != MAP_FAILED);
+    return p;
+  }
+  std::string path = dir_ + "/countprimes-XXXXXX";
+  int fd = mkstemp(path.data());
+  ASSERT_FATAL(fd != -1);
+  // The file lives until the mapping is removed.
+  ASSERT_FATAL(unlink(path.c_str()) == 0);
+  ASSERT_FATAL(ftruncate(fd, bytes) == 0);
+  void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ASSERT_FATAL(p != MAP_FAILED);
+  return p;
+}
+
+void storage::details::unmap(void* p, size_t bytes) {
+  ASSERT_FATAL(munmap(p, bytes) == 0);
+}
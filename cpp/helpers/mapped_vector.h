@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace storage {
+// Out-of-core mode: When a directory is set, large buffers are memory-mapped
+// files in it (deleted on creation), so their total size is bounded by the
+// disk instead of the RAM, and the page cache keeps the hot parts in memory.
+// Empty (the default) keeps everything in RAM. Set it before computing.
+void set_dir(const std::string& dir);
+const std::string& get_dir();
+bool out_of_core();
+
+// The memory (in bytes) that the stages which trade memory for concurrency
+// (the Mobius prime ranges) may keep alive. 0, the default, runs them one at
+// a time. Set it before computing.
+void set_memory_budget(size_t bytes);
+size_t get_memory_budget();
+
+namespace details {
+// Buffers smaller than this are regular allocations, aligned to a cache line
+// (the mapped ones are aligned to a page).
+constexpr size_t min_mapped_bytes = 1ull << 26;
+constexpr size_t align = 64;
+void* map(size_t bytes);
+void unmap(void* p, size_t bytes);
+}  // namespace details
+}  // namespace storage
+
+// Allocator for the large vectors of the pipeline, see storage::set_dir.
+template <typename T>
+struct MappedAllocator {
+  using value_type = T;
+
+  MappedAllocator() = default;
+  template <typename U>
+  MappedAllocator(const MappedAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    const size_t bytes = n * sizeof(T);
+    if (bytes < storage::details::min_mapped_bytes) {
+      return static_cast<T*>(
+          ::operator new(bytes, std::align_val_t(storage::details::align)));
+    }
+    return static_cast<T*>(storage::details::map(bytes));
+  }
+  void deallocate(T* p, size_t n) {
+    const size_t bytes = n * sizeof(T);
+    if (bytes < storage::details::min_mapped_bytes) {
+      ::operator delete(p, std::align_val_t(storage::details::align));
+    } else {
+      storage::details::unmap(p, bytes);
+    }
+  }
+  template <typename U>
+  bool operator==(const MappedAllocator<U>&) const {
+    return true;
+  }
+};
+
+template <typename T>
+using mapped_vector = std::vector<T, MappedAllocator<T>>;
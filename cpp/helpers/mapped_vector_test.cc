@@ -0,0 +1,29 @@
+#include "mapped_vector.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <numeric>
+#include <vector>
+
+#include "../NTT/ntt.h"
+#include "mod_int.h"
+
+TEST(mapped_vector, out_of_core_ntt) {
+  const auto dir = std::filesystem::temp_directory_path();
+  // Large enough to be mapped, and for the six-step order.
+  constexpr size_t n = 1ull << 23;
+  std::vector<mint> expected(n);
+  std::iota(expected.begin(), expected.end(), 1);
+  storage::set_dir(dir.string());
+  {
+    mapped_vector<mint> v(expected.begin(), expected.end());
+    ntt(v);
+    ntt(expected);
+    EXPECT_TRUE(std::equal(v.begin(), v.end(), expected.begin()));
+    intt(v);
+    for (size_t i = 0; i < n; ++i) ASSERT_EQ(v[i], mint(i + 1)) << i;
+  }
+  storage::set_dir("");
+  EXPECT_FALSE(storage::out_of_core());
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "assertion.h"
+#include "mod_int.h"
+#include "mod_int_simd.h"
+
+/**
+ * Bulk operations on spans of ModInts, with the widest simd::Pack and a
+ * scalar tail. The operands have the same size, and the destination may only
+ * alias a source that is the same span.
+ * The spans deduce mint_t, the other operands convert to it.
+ * The kernels are single threaded, callers split large spans between threads
+ * (see parallel::parallel_for).
+ * aligned_vector and mapped_vector buffers start on a cache line, so the packs
+ * of a span that starts at the beginning of one do not cross cache lines.
+ */
+namespace mint_span {
+namespace details {
+// Calls func(type_identity<Pack>, i) on i = 0, width, ..., and then
+// func(type_identity<ScalarPack>, i) on the rest of [0, size).
+template <typename mint_t, typename Func>
+inline void for_each_pack(size_t size, Func&& func) {
+  using Pack = simd::Pack<mint_t>;
+  size_t i = 0;
+  for (; i + Pack::width <= size; i += Pack::width) {
+    func(std::type_identity<Pack>(), i);
+  }
+  for (; i < size; ++i) {
+    func(std::type_identity<simd::ScalarPack<mint_t>>(), i);
+  }
+}
+
+// c in every lane of the packs, normalized for mul_normalized.
+template <typename mint_t>
+class Broadcast {
+ public:
+  explicit Broadcast(mint_t c) : m_scalar{c.normalize()} {
+    std::array<mint_t, simd::Pack<mint_t>::width> lanes;
+    lanes.fill(c);
+    m_pack = simd::Pack<mint_t>::load(lanes.data());
+  }
+  template <typename P>
+  const P& get() const {
+    if constexpr (std::is_same_v<P, simd::ScalarPack<mint_t>>) {
+      return m_scalar;
+    } else {
+      return m_pack;
+    }
+  }
+
+ private:
+  simd::Pack<mint_t> m_pack;
+  simd::ScalarPack<mint_t> m_scalar;
+};
+}  // namespace details
+
+// dst[i] += a[i]
+template <typename mint_t>
+void add(std::span<mint_t> dst,
+         std::type_identity_t<std::span<const mint_t>> a) {
+  ASSERT_FATAL(dst.size() == a.size());
+  details::for_each_pack<mint_t>(dst.size(), [&]<typename P>(
+                                                 std::type_identity<P>,
+                                                 size_t i) {
+    (P::load(&dst[i]) + P::load(&a[i])).store(&dst[i]);
+  });
+}
+
+// dst[i] -= a[i]
+template <typename mint_t>
+void sub(std::span<mint_t> dst,
+         std::type_identity_t<std::span<const mint_t>> a) {
+  ASSERT_FATAL(dst.size() == a.size());
+  details::for_each_pack<mint_t>(dst.size(), [&]<typename P>(
+                                                 std::type_identity<P>,
+                                                 size_t i) {
+    (P::load(&dst[i]) - P::load(&a[i])).store(&dst[i]);
+  });
+}
+
+// dst[i] *= a[i]
+template <typename mint_t>
+void mul(std::span<mint_t> dst,
+         std::type_identity_t<std::span<const mint_t>> a) {
+  ASSERT_FATAL(dst.size() == a.size());
+  details::for_each_pack<mint_t>(dst.size(), [&]<typename P>(
+                                                 std::type_identity<P>,
+                                                 size_t i) {
+    (P::load(&dst[i]) * P::load(&a[i])).store(&dst[i]);
+  });
+}
+
+// dst[i] *= c
+template <typename mint_t>
+void scale(std::span<mint_t> dst, std::type_identity_t<mint_t> c) {
+  const details::Broadcast factor(c);
+  details::for_each_pack<mint_t>(dst.size(), [&]<typename P>(
+                                                 std::type_identity<P>,
+                                                 size_t i) {
+    P::load(&dst[i]).mul_normalized(factor.template get<P>()).store(&dst[i]);
+  });
+}
+
+// dst[i] += c * x[i]
+template <typename mint_t>
+void axpy(std::span<mint_t> dst, std::type_identity_t<mint_t> c,
+          std::type_identity_t<std::span<const mint_t>> x) {
+  ASSERT_FATAL(dst.size() == x.size());
+  const details::Broadcast factor(c);
+  details::for_each_pack<mint_t>(dst.size(), [&]<typename P>(
+                                                 std::type_identity<P>,
+                                                 size_t i) {
+    auto product = P::load(&x[i]).mul_normalized(factor.template get<P>());
+    (P::load(&dst[i]) + product).store(&dst[i]);
+  });
+}
+
+// v[i] -= v[i - shift] for i >= shift, with the values of v before the call
+// (multiplies the polynomial v by 1 - x^shift, truncated to its size).
+template <typename mint_t>
+void shifted_subtract(std::span<mint_t> v, size_t shift) {
+  ASSERT_FATAL(shift > 0);
+  if (shift >= v.size()) return;
+  using Pack = simd::Pack<mint_t>;
+  // From the end, so that v[i - shift] is not modified yet. Within a pack the
+  // loads come before the store.
+  size_t i = v.size();
+  for (; i >= shift + Pack::width; i -= Pack::width) {
+    mint_t* p = &v[i - Pack::width];
+    (Pack::load(p) - Pack::load(p - shift)).store(p);
+  }
+  for (; i > shift; --i) v[i - 1] -= v[i - 1 - shift];
+}
+
+// The term coef * x^shift of a sparse polynomial.
+template <typename mint_t>
+struct SparseTerm {
+  size_t shift;
+  mint_t coef;
+};
+
+// The terms of a sparse polynomial 1 + sum of coef * x^shift, split by coef
+// (+1, -1, and the others) for sparse_multiply, which reuses them.
+template <typename mint_t>
+class SparseTerms {
+ public:
+  // The shifts are increasing and positive.
+  explicit SparseTerms(std::span<const SparseTerm<mint_t>> terms) {
+    for (size_t t = 0; t < terms.size(); ++t) {
+      const auto& term = terms[t];
+      ASSERT_FATAL(term.shift > 0);
+      ASSERT_FATAL(t == 0 || terms[t - 1].shift < term.shift);
+      m_shifts.push_back(term.shift);
+      if (term.coef == 1) {
+        m_adds.push_back(term.shift);
+      } else if (term.coef == -1) {
+        m_subs.push_back(term.shift);
+      } else {
+        m_muls.push_back(term.shift);
+        m_coefs.emplace_back(term.coef);
+      }
+      m_prefix_sizes.push_back({m_adds.size(), m_subs.size(), m_muls.size()});
+    }
+  }
+  size_t size() const { return m_shifts.size(); }
+
+ private:
+  template <typename T>
+  friend void sparse_multiply(std::span<T> dst,
+                              std::type_identity_t<std::span<const T>> src,
+                              size_t begin, size_t end,
+                              const SparseTerms<T>& terms);
+
+  std::vector<size_t> m_shifts, m_adds, m_subs, m_muls;
+  std::vector<details::Broadcast<mint_t>> m_coefs;
+  // The sizes of m_adds, m_subs and m_muls from the first t + 1 terms.
+  std::vector<std::array<size_t, 3>> m_prefix_sizes;
+};
+
+// dst[i] = src[i] + sum of coef * src[i - shift] over the terms with
+// shift <= i, for i in [begin, end): the product of the polynomial src with
+// 1 + terms, on those positions. dst and src do not overlap.
+template <typename mint_t>
+void sparse_multiply(std::span<mint_t> dst,
+                     std::type_identity_t<std::span<const mint_t>> src,
+                     size_t begin, size_t end,
+                     const SparseTerms<mint_t>& terms) {
+  ASSERT_FATAL(dst.size() == src.size());
+  ASSERT_FATAL(begin <= end && end <= dst.size());
+  // The positions in [shifts[t - 1], shifts[t]) read the first t terms.
+  const auto& shifts = terms.m_shifts;
+  for (size_t t = 0, lo = begin; lo < end; ++t) {
+    const size_t hi = t < shifts.size() ? std::clamp(shifts[t], lo, end) : end;
+    if (lo == hi) continue;
+    std::array<size_t, 3> sizes = {0, 0, 0};
+    if (t > 0) sizes = terms.m_prefix_sizes[t - 1];
+    const std::span adds(terms.m_adds.data(), sizes[0]);
+    const std::span subs(terms.m_subs.data(), sizes[1]);
+    const std::span muls(terms.m_muls.data(), sizes[2]);
+    details::for_each_pack<mint_t>(hi - lo, [&]<typename P>(
+                                                std::type_identity<P>,
+                                                size_t i) {
+      const mint_t* p = &src[lo + i];
+      auto acc = P::load(p);
+      for (size_t shift : adds) acc = acc + P::load(p - shift);
+      for (size_t shift : subs) acc = acc - P::load(p - shift);
+      for (size_t m = 0; m < muls.size(); ++m) {
+        acc = acc + P::load(p - muls[m]).mul_normalized(
+                        terms.m_coefs[m].template get<P>());
+      }
+      acc.store(&dst[lo + i]);
+    });
+    lo = hi;
+  }
+}
+}  // namespace mint_span
@@ -0,0 +1,81 @@
+#include "mint_span.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "aligned_vector.h"
+#include "mod_int.h"
+
+template <typename mint_t>
+void test_kernels() {
+  using V = std::vector<mint_t>;
+  std::mt19937_64 rng(1);
+  // Sizes with and without a scalar tail.
+  for (size_t n : {0, 1, 7, 8, 16, 100}) {
+    V a(n), b(n);
+    for (auto& i : a) i = rng();
+    for (auto& i : b) i = rng();
+    const mint_t c = rng();
+    auto check = [&](auto kernel, auto expected_op) {
+      V res = a;
+      kernel(res);
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(res[i], expected_op(i)) << n << " " << i;
+      }
+    };
+    check([&](V& v) { mint_span::add(std::span(v), b); },
+          [&](size_t i) { return a[i] + b[i]; });
+    check([&](V& v) { mint_span::sub(std::span(v), b); },
+          [&](size_t i) { return a[i] - b[i]; });
+    check([&](V& v) { mint_span::mul(std::span(v), b); },
+          [&](size_t i) { return a[i] * b[i]; });
+    check([&](V& v) { mint_span::scale(std::span(v), c); },
+          [&](size_t i) { return a[i] * c; });
+    check([&](V& v) { mint_span::axpy(std::span(v), c, b); },
+          [&](size_t i) { return a[i] + c * b[i]; });
+    for (size_t shift : {1, 3, 8, 50, 200}) {
+      check([&](V& v) { mint_span::shifted_subtract(std::span(v), shift); },
+            [&](size_t i) { return i >= shift ? a[i] - a[i - shift] : a[i]; });
+    }
+    // Out of place, in blocks (shorter than the packs, and longer) that start
+    // before the shifts and after them.
+    for (size_t shift : {3, 40}) {
+      const std::vector<mint_span::SparseTerm<mint_t>> terms = {
+          {shift, 1}, {shift + 5, -1}, {2 * shift + 14, c}};
+      const mint_span::SparseTerms<mint_t> sparse_terms(terms);
+      check(
+          [&](V& v) {
+            const V src = v;
+            for (size_t begin = 0; begin < n; begin += shift + 2) {
+              mint_span::sparse_multiply(std::span(v), src, begin,
+                                         std::min(begin + shift + 2, n),
+                                         sparse_terms);
+            }
+          },
+          [&](size_t i) {
+            mint_t res = a[i];
+            for (const auto& term : terms) {
+              if (i >= term.shift) res += term.coef * a[i - term.shift];
+            }
+            return res;
+          });
+    }
+  }
+}
+
+TEST(mint_span, kernels) {
+  test_kernels<mint>();
+  test_kernels<mint2>();
+  test_kernels<ModInt32<1'000'000'007>>();
+}
+
+TEST(mint_span, subspan) {
+  aligned_vector<mint> v(64, 5);
+  mint_span::scale(std::span(v).subspan(3, 40), mint(2));
+  for (size_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(v[i], i >= 3 && i < 43 ? 10 : 5) << i;
+  }
+}
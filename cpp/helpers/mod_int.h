@@ -7,6 +7,9 @@
 #include "double_int.h"
 #include "math.h"
 
+template <typename mint_t>
+class ShoupMultiplier;
+
 namespace details {
 template <std::unsigned_integral T, T MOD>
 static consteval T compute_r() {
@@ -84,6 +87,13 @@ struct ModInt_impl {
 
   constexpr Base inverse() const { return this->pow(MOD - 2); }
 
+  // Keeps the value, with the raw representation in [0, MOD) instead of
+  // [0, 2*MOD). The SIMD packs multiply by such values with less work.
+  constexpr Base &normalize() {
+    value = normalized();
+    return *this;
+  }
+
   // Return the value modulo MOD ([0, MOD))
   constexpr T get() const {
     T ans = montgomery_mod(value);
@@ -98,6 +108,9 @@ struct ModInt_impl {
   static constexpr T get_mod() { return MOD; }
 
  private:
+  template <typename>
+  friend class ::ShoupMultiplier;
+
   static constexpr size_t num_bits = sizeof(T) * 8;
   static constexpr T two_power_2num_bits = pow_mod(T(2), num_bits * 2, MOD);
   static constexpr T r = compute_r<T, MOD>();
@@ -132,7 +145,49 @@ using ModInt64 = details::ModInt_impl<uint64_t, MOD>;
 template <uint32_t MOD>
 using ModInt32 = details::ModInt_impl<uint32_t, MOD>;
 
+/**
+ * A constant factor with its Shoup precomputed quotient, for values that
+ * multiply many ModInts (twiddles, inverses): c and c' = floor(c * 2^w / MOD)
+ * for a word of w bits. Then for any raw value x, x * c - hi(x * c') * MOD
+ * is in [0, 2*MOD), which is x * c modulo MOD in the ModInt representation
+ * (Montgomery form is preserved because c is kept plain). That is a high and
+ * two low multiplications, against a double width one and a reduction.
+ */
+template <typename mint_t>
+class ShoupMultiplier {
+  using T = std::remove_const_t<decltype(mint_t::mod)>;
+  static constexpr size_t num_bits = sizeof(T) * 8;
+
+ public:
+  constexpr ShoupMultiplier() : m_value(0), m_quotient(0) {}
+  constexpr ShoupMultiplier(const mint_t &c)
+      : m_value(c.get()),
+        m_quotient((double_int_t<T>(m_value) << num_bits) / mint_t::mod) {}
+
+  constexpr mint_t value() const { return mint_t(m_value); }
+
+  friend constexpr mint_t &operator*=(mint_t &x, const ShoupMultiplier &c) {
+    return c.multiply(x);
+  }
+  friend constexpr mint_t operator*(mint_t x, const ShoupMultiplier &c) {
+    return x *= c;
+  }
+
+ private:
+  constexpr mint_t &multiply(mint_t &x) const {
+    const T q = wide_mul<T>(x.value, m_quotient) >> num_bits;
+    x.value = x.value * m_value - q * mint_t::mod;
+    return x;
+  }
+
+  T m_value, m_quotient;
+};
+
 template <std::unsigned_integral T, T MOD>
 struct std::is_integral<details::ModInt_impl<T, MOD>> : std::true_type {};
 
 using mint = ModInt64<MOD>;
+using mint2 = ModInt64<MOD2>;
+using mint3 = ModInt64<MOD3>;
+using mint32 = ModInt32<MOD32>;
+using mint32_2 = ModInt32<MOD32_2>;
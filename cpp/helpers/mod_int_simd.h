@@ -0,0 +1,312 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "mod_int.h"
+
+/**
+ * Packs of ModInts that are operated on together (one per SIMD lane).
+ * All packs have the same interface:
+ *   mint_t, width, load(const mint_t*), store(mint_t*), +, -, *,
+ *   mul_normalized (like *, for an operand normalized with
+ *   ModInt::normalize, such as the NTT twiddles)
+ * and agree with the scalar ModInt operations lane by lane (equality as
+ * ModInts, the raw representation might differ in [0, 2*MOD)).
+ *
+ * The vectorized packs are selected at compile time (we build with
+ * -march=native), for ModInt64 with MOD < 2^32: The lanes keep the raw
+ * ModInt64 value (x * 2^64 % MOD in [0, 2*MOD)), and a multiplication is a
+ * 32x32->64 bits product followed by two 32-bit Montgomery reductions, which
+ * is the same as a single 64-bit reduction.
+ * The reduction only needs one of the factors in [0, MOD), and the other one
+ * to fit in 32 bits. So when 2*MOD < 2^32, the raw [0, 2*MOD) values are
+ * multiplied as they are (lazily), and products by normalized operands never
+ * normalize.
+ *
+ * And for ModInt32 (MOD < 2^30), with twice the lanes: A product of raw values
+ * is less than 4*MOD^2 < 2^32 * MOD, so a single reduction (of the even and
+ * the odd lanes separately) is enough, and nothing is normalized.
+ */
+namespace simd {
+template <typename T>
+struct ScalarPack {
+  using mint_t = T;
+  static constexpr size_t width = 1;
+  static ScalarPack load(const mint_t* p) { return {*p}; }
+  void store(mint_t* p) const { *p = v; }
+  ScalarPack operator+(const ScalarPack& o) const { return {v + o.v}; }
+  ScalarPack operator-(const ScalarPack& o) const { return {v - o.v}; }
+  ScalarPack operator*(const ScalarPack& o) const { return {v * o.v}; }
+  ScalarPack mul_normalized(const ScalarPack& o) const { return {v * o.v}; }
+  mint_t v;
+};
+
+namespace details {
+template <uint64_t MOD>
+struct MontgomeryConstants32 {
+  static_assert(MOD < (1ull << 32));
+  // -MOD^-1 modulo 2^32.
+  static constexpr uint64_t r =
+      uint32_t(-::details::compute_r<uint32_t, uint32_t(MOD)>());
+};
+}  // namespace details
+
+#ifdef __AVX2__
+template <uint64_t MOD>
+struct Avx2Pack {
+  using mint_t = ModInt64<MOD>;
+  static_assert(sizeof(mint_t) == sizeof(uint64_t));
+  static constexpr size_t width = 4;
+
+  static Avx2Pack load(const mint_t* p) {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))};
+  }
+  void store(mint_t* p) const {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  Avx2Pack operator+(const Avx2Pack& o) const {
+    // Values are less than 2^34, so signed comparisons are fine.
+    return {fix_negative(_mm256_sub_epi64(_mm256_add_epi64(v, o.v), mod2()))};
+  }
+  Avx2Pack operator-(const Avx2Pack& o) const {
+    return {fix_negative(_mm256_sub_epi64(v, o.v))};
+  }
+  Avx2Pack operator*(const Avx2Pack& o) const {
+    return mul_normalized({normalize(o.v)});
+  }
+  Avx2Pack mul_normalized(const Avx2Pack& o) const {
+    auto prod = _mm256_mul_epu32(lazy_factor(v), o.v);
+    return {reduce(reduce(prod))};
+  }
+
+  __m256i v;
+
+ private:
+  static __m256i mod() { return _mm256_set1_epi64x(MOD); }
+  static __m256i mod2() { return _mm256_set1_epi64x(2 * MOD); }
+  // [-2*MOD, 2*MOD) -> [0, 2*MOD)
+  static __m256i fix_negative(__m256i x) {
+    auto neg = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+    return _mm256_add_epi64(x, _mm256_and_si256(neg, mod2()));
+  }
+  // [0, 2*MOD) -> [0, MOD)
+  static __m256i normalize(__m256i x) {
+    auto sub = _mm256_sub_epi64(x, mod());
+    auto neg = _mm256_cmpgt_epi64(_mm256_setzero_si256(), sub);
+    return _mm256_blendv_epi8(sub, x, neg);
+  }
+  // [0, 2*MOD) -> a factor for a product with a value in [0, MOD).
+  static __m256i lazy_factor(__m256i x) {
+    if constexpr (2 * MOD < (1ull << 32)) return x;
+    return normalize(x);
+  }
+  // Returns (x * 2^-32 % MOD), in [0, 2*MOD) if x < 2^32 * MOD.
+  static __m256i reduce(__m256i x) {
+    auto m = _mm256_mul_epu32(
+        x, _mm256_set1_epi64x(details::MontgomeryConstants32<MOD>::r));
+    auto m_mod = _mm256_mul_epu32(m, mod());
+    // Whether there is a carry from the lower bits.
+    auto low_zero = _mm256_cmpeq_epi64(
+        _mm256_and_si256(x, _mm256_set1_epi64x(0xFFFFFFFF)),
+        _mm256_setzero_si256());
+    auto carry = _mm256_add_epi64(_mm256_set1_epi64x(1), low_zero);
+    auto res = _mm256_add_epi64(_mm256_srli_epi64(x, 32),
+                                _mm256_srli_epi64(m_mod, 32));
+    return _mm256_add_epi64(res, carry);
+  }
+};
+#endif
+
+#ifdef __AVX512F__
+// GCC 12 wrongly warns on the unmasked AVX-512 intrinsics (GCC bug 105593).
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+template <uint64_t MOD>
+struct Avx512Pack {
+  using mint_t = ModInt64<MOD>;
+  static_assert(sizeof(mint_t) == sizeof(uint64_t));
+  static constexpr size_t width = 8;
+
+  static Avx512Pack load(const mint_t* p) {
+    return {_mm512_loadu_si512(p)};
+  }
+  void store(mint_t* p) const { _mm512_storeu_si512(p, v); }
+  Avx512Pack operator+(const Avx512Pack& o) const {
+    auto sum = _mm512_add_epi64(v, o.v);
+    return {_mm512_min_epu64(sum, _mm512_sub_epi64(sum, mod2()))};
+  }
+  Avx512Pack operator-(const Avx512Pack& o) const {
+    auto diff = _mm512_add_epi64(_mm512_sub_epi64(v, o.v), mod2());
+    return {_mm512_min_epu64(diff, _mm512_sub_epi64(diff, mod2()))};
+  }
+  Avx512Pack operator*(const Avx512Pack& o) const {
+    return mul_normalized({normalize(o.v)});
+  }
+  Avx512Pack mul_normalized(const Avx512Pack& o) const {
+    auto prod = _mm512_mul_epu32(lazy_factor(v), o.v);
+    return {reduce(reduce(prod))};
+  }
+
+  __m512i v;
+
+ private:
+  static __m512i mod() { return _mm512_set1_epi64(MOD); }
+  static __m512i mod2() { return _mm512_set1_epi64(2 * MOD); }
+  // [0, 2*MOD) -> [0, MOD)
+  static __m512i normalize(__m512i x) {
+    return _mm512_min_epu64(x, _mm512_sub_epi64(x, mod()));
+  }
+  // [0, 2*MOD) -> a factor for a product with a value in [0, MOD).
+  static __m512i lazy_factor(__m512i x) {
+    if constexpr (2 * MOD < (1ull << 32)) return x;
+    return normalize(x);
+  }
+  // Returns (x * 2^-32 % MOD), in [0, 2*MOD) if x < 2^32 * MOD.
+  static __m512i reduce(__m512i x) {
+    auto m = _mm512_mul_epu32(
+        x, _mm512_set1_epi64(details::MontgomeryConstants32<MOD>::r));
+    auto m_mod = _mm512_mul_epu32(m, mod());
+    auto res = _mm512_add_epi64(_mm512_srli_epi64(x, 32),
+                                _mm512_srli_epi64(m_mod, 32));
+    // Add the carry from the lower bits.
+    auto low_non_zero =
+        _mm512_test_epi64_mask(x, _mm512_set1_epi64(0xFFFFFFFF));
+    return _mm512_mask_add_epi64(res, low_non_zero, res,
+                                 _mm512_set1_epi64(1));
+  }
+};
+#pragma GCC diagnostic pop
+#endif
+
+#ifdef __AVX2__
+template <uint32_t MOD>
+struct Avx2Pack32 {
+  using mint_t = ModInt32<MOD>;
+  static_assert(sizeof(mint_t) == sizeof(uint32_t));
+  static constexpr size_t width = 8;
+
+  static Avx2Pack32 load(const mint_t* p) {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))};
+  }
+  void store(mint_t* p) const {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  Avx2Pack32 operator+(const Avx2Pack32& o) const {
+    auto sum = _mm256_add_epi32(v, o.v);
+    return {_mm256_min_epu32(sum, _mm256_sub_epi32(sum, mod2()))};
+  }
+  Avx2Pack32 operator-(const Avx2Pack32& o) const {
+    auto diff = _mm256_add_epi32(_mm256_sub_epi32(v, o.v), mod2());
+    return {_mm256_min_epu32(diff, _mm256_sub_epi32(diff, mod2()))};
+  }
+  Avx2Pack32 operator*(const Avx2Pack32& o) const {
+    auto even = reduce(_mm256_mul_epu32(v, o.v));
+    auto odd = reduce(
+        _mm256_mul_epu32(_mm256_srli_epi64(v, 32), _mm256_srli_epi64(o.v, 32)));
+    return {_mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0b10101010)};
+  }
+  Avx2Pack32 mul_normalized(const Avx2Pack32& o) const { return *this * o; }
+
+  __m256i v;
+
+ private:
+  static __m256i mod() { return _mm256_set1_epi32(MOD); }
+  static __m256i mod2() { return _mm256_set1_epi32(2 * MOD); }
+  // Returns (x * 2^-32 % MOD) in [0, 2*MOD), for 64-bit lanes x < 2^32 * MOD.
+  // The sum has no overflow since MOD < 2^30.
+  static __m256i reduce(__m256i x) {
+    auto m = _mm256_mul_epu32(
+        x, _mm256_set1_epi64x(details::MontgomeryConstants32<MOD>::r));
+    return _mm256_srli_epi64(_mm256_add_epi64(x, _mm256_mul_epu32(m, mod())),
+                             32);
+  }
+};
+#endif
+
+#ifdef __AVX512F__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+template <uint32_t MOD>
+struct Avx512Pack32 {
+  using mint_t = ModInt32<MOD>;
+  static_assert(sizeof(mint_t) == sizeof(uint32_t));
+  static constexpr size_t width = 16;
+
+  static Avx512Pack32 load(const mint_t* p) {
+    return {_mm512_loadu_si512(p)};
+  }
+  void store(mint_t* p) const { _mm512_storeu_si512(p, v); }
+  Avx512Pack32 operator+(const Avx512Pack32& o) const {
+    auto sum = _mm512_add_epi32(v, o.v);
+    return {_mm512_min_epu32(sum, _mm512_sub_epi32(sum, mod2()))};
+  }
+  Avx512Pack32 operator-(const Avx512Pack32& o) const {
+    auto diff = _mm512_add_epi32(_mm512_sub_epi32(v, o.v), mod2());
+    return {_mm512_min_epu32(diff, _mm512_sub_epi32(diff, mod2()))};
+  }
+  Avx512Pack32 operator*(const Avx512Pack32& o) const {
+    auto even = reduce(_mm512_mul_epu32(v, o.v));
+    auto odd = reduce(
+        _mm512_mul_epu32(_mm512_srli_epi64(v, 32), _mm512_srli_epi64(o.v, 32)));
+    return {_mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32))};
+  }
+  Avx512Pack32 mul_normalized(const Avx512Pack32& o) const {
+    return *this * o;
+  }
+
+  __m512i v;
+
+ private:
+  static __m512i mod() { return _mm512_set1_epi32(MOD); }
+  static __m512i mod2() { return _mm512_set1_epi32(2 * MOD); }
+  // See Avx2Pack32::reduce.
+  static __m512i reduce(__m512i x) {
+    auto m = _mm512_mul_epu32(
+        x, _mm512_set1_epi64(details::MontgomeryConstants32<MOD>::r));
+    return _mm512_srli_epi64(_mm512_add_epi64(x, _mm512_mul_epu32(m, mod())),
+                             32);
+  }
+};
+#pragma GCC diagnostic pop
+#endif
+
+namespace details {
+template <typename mint_t>
+struct BestPack {
+  using type = ScalarPack<mint_t>;
+};
+
+template <uint64_t MOD>
+  requires(MOD < (1ull << 32))
+struct BestPack<ModInt64<MOD>> {
+#if defined(__AVX512F__)
+  using type = Avx512Pack<MOD>;
+#elif defined(__AVX2__)
+  using type = Avx2Pack<MOD>;
+#else
+  using type = ScalarPack<ModInt64<MOD>>;
+#endif
+};
+
+template <uint32_t MOD>
+  requires(MOD < (1u << 30))
+struct BestPack<ModInt32<MOD>> {
+#if defined(__AVX512F__)
+  using type = Avx512Pack32<MOD>;
+#elif defined(__AVX2__)
+  using type = Avx2Pack32<MOD>;
+#else
+  using type = ScalarPack<ModInt32<MOD>>;
+#endif
+};
+}  // namespace details
+
+// The widest pack available for `mint_t` on this build.
+template <typename mint_t>
+using Pack = typename details::BestPack<mint_t>::type;
+}  // namespace simd
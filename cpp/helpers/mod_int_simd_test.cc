@@ -0,0 +1,71 @@
+#include "mod_int_simd.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "mod_int.h"
+
+template <typename Pack>
+void test_pack_matches_scalar() {
+  using mint_t = typename Pack::mint_t;
+  constexpr size_t n = Pack::width * 1000;
+  std::mt19937_64 rng(123);
+  std::vector<mint_t> a(n), b(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = rng();
+    b[i] = rng();
+  }
+  // Edge values, and values that are not normalized.
+  a[0] = 0, b[0] = mint_t::get_mod() - 1;
+  a[1] = -1, b[1] = -1;
+  a[2] = b[2] = mint_t(7) * mint_t(-3);
+  for (size_t i = 0; i < n; i += Pack::width) {
+    std::vector<mint_t> res(Pack::width);
+    auto x = Pack::load(&a[i]), y = Pack::load(&b[i]);
+    (x + y).store(res.data());
+    for (size_t j = 0; j < Pack::width; ++j)
+      ASSERT_EQ(res[j], a[i + j] + b[i + j]);
+    (x - y).store(res.data());
+    for (size_t j = 0; j < Pack::width; ++j)
+      ASSERT_EQ(res[j], a[i + j] - b[i + j]);
+    (x * y).store(res.data());
+    for (size_t j = 0; j < Pack::width; ++j)
+      ASSERT_EQ(res[j], a[i + j] * b[i + j]);
+    std::vector<mint_t> normalized(&b[i], &b[i] + Pack::width);
+    for (auto& v : normalized) v.normalize();
+    x.mul_normalized(Pack::load(normalized.data())).store(res.data());
+    for (size_t j = 0; j < Pack::width; ++j)
+      ASSERT_EQ(res[j], a[i + j] * b[i + j]);
+    ((x * y) * (x - y) + x).store(res.data());
+    for (size_t j = 0; j < Pack::width; ++j) {
+      auto u = a[i + j], v = b[i + j];
+      ASSERT_EQ(res[j], (u * v) * (u - v) + u);
+    }
+  }
+}
+
+TEST(mod_int_simd, scalar_pack) {
+  test_pack_matches_scalar<simd::ScalarPack<mint>>();
+}
+
+TEST(mod_int_simd, best_pack) { test_pack_matches_scalar<simd::Pack<mint>>(); }
+
+// 2 * MOD2 < 2^32, so its products are lazy.
+TEST(mod_int_simd, best_pack_small_mod) {
+  test_pack_matches_scalar<simd::Pack<mint2>>();
+}
+
+// 32-bit lanes.
+TEST(mod_int_simd, best_pack_32) {
+  test_pack_matches_scalar<simd::Pack<mint32>>();
+  test_pack_matches_scalar<simd::Pack<mint32_2>>();
+}
+
+#ifdef __AVX2__
+TEST(mod_int_simd, avx2_pack) {
+  test_pack_matches_scalar<simd::Avx2Pack<MOD>>();
+  test_pack_matches_scalar<simd::Avx2Pack32<MOD32>>();
+}
+#endif
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <random>
 
 #include "benchmark.h"
 
@@ -30,6 +31,30 @@ TEST(mod_int, operators) {
   }
 }
 
+template <typename mint_t>
+void test_shoup_multiplier() {
+  std::mt19937_64 rng(1);
+  for (mint_t c : {mint_t(0), mint_t(1), mint_t(-1), mint_t(rng())}) {
+    const ShoupMultiplier<mint_t> shoup = c;
+    EXPECT_EQ(shoup.value(), c);
+    for (mint_t x : {mint_t(0), mint_t(-1), mint_t(rng()), mint_t(rng())}) {
+      ASSERT_EQ(x * shoup, x * c) << x << " " << c;
+      // Also for raw values in [MOD, 2 * MOD).
+      mint_t y = x + mint_t(0);
+      ASSERT_EQ(y * shoup, y * c) << y << " " << c;
+      // The result is a valid ModInt: It can be used in other operations.
+      mint_t prod = x * shoup;
+      ASSERT_EQ(prod + prod - x * c, x * c);
+    }
+  }
+}
+
+TEST(mod_int, shoup_multiplier) {
+  test_shoup_multiplier<mi>();
+  test_shoup_multiplier<mint>();
+  test_shoup_multiplier<mint2>();
+}
+
 TEST(benchmark, mod_int) {
   benchmark_code([]() {
     mi x;
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "assertion.h"
+#include "mod_int.h"
+
+/**
+ * The NTT friendly moduli that the pipeline (NTT, Mobius and the prime count)
+ * is instantiated for, cheapest first: The 32-bit ones use half the memory and
+ * twice the SIMD lanes, but have smaller maximal transforms.
+ * All of them have 3 | MOD - 1, for the transforms of size 3 * 2^k.
+ */
+using NttModInts = std::tuple<mint32, mint32_2, mint, mint2, mint3>;
+
+constexpr auto ntt_moduli = []<typename... mint_ts>(
+                                std::type_identity<std::tuple<mint_ts...>>) {
+  return std::array<uint64_t, sizeof...(mint_ts)>{mint_ts::get_mod()...};
+}(std::type_identity<NttModInts>());
+
+// The largest k such that 2^k | mod - 1: The transforms are of sizes up to
+// 2^k, and 3 * 2^k.
+constexpr size_t max_ntt_lg2_size(uint64_t mod) {
+  return __builtin_ctzll(mod - 1);
+}
+
+// Returns func.template operator()<mint_t>() for the mint_t of NttModInts
+// whose modulus is `mod`.
+template <typename Func>
+auto dispatch_modulus(uint64_t mod, Func&& func) {
+  using Result = decltype(func.template operator()<mint>());
+  std::optional<Result> res;
+  [&]<typename... mint_ts>(std::type_identity<std::tuple<mint_ts...>>) {
+    ((mint_ts::get_mod() == mod
+          ? void(res.emplace(func.template operator()<mint_ts>()))
+          : void()),
+     ...);
+  }(std::type_identity<NttModInts>());
+  ASSERT_FATAL(res.has_value());  // Not one of ntt_moduli.
+  return std::move(res.value());
+}
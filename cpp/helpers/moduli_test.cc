@@ -0,0 +1,27 @@
+#include "moduli.h"
+
+#include <gtest/gtest.h>
+
+#include "math.h"
+
+TEST(moduli, ntt_friendly) {
+  for (uint64_t mod : ntt_moduli) {
+    EXPECT_TRUE(is_prime(mod)) << mod;
+    EXPECT_EQ((mod - 1) % 3, 0) << mod;
+    EXPECT_GE(max_ntt_lg2_size(mod), 23) << mod;
+  }
+  EXPECT_EQ(max_ntt_lg2_size(MOD), 30);
+  EXPECT_EQ(max_ntt_lg2_size(MOD32), 24);
+}
+
+TEST(moduli, dispatch) {
+  for (uint64_t mod : ntt_moduli) {
+    const auto [res, size] = dispatch_modulus(
+        mod, []<typename mint_t>() -> std::pair<uint64_t, size_t> {
+          return {mint_t::get_mod(), sizeof(mint_t)};
+        });
+    EXPECT_EQ(res, mod);
+    EXPECT_EQ(size, mod < (1ull << 30) ? 4 : 8);
+  }
+  EXPECT_ANY_THROW(dispatch_modulus(7, []<typename mint_t>() { return 0; }));
+}
@@ -0,0 +1,128 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "assertion.h"
+
+namespace {
+size_t default_num_threads() {
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+std::atomic<size_t> num_threads_ = default_num_threads();
+// The share of the current thread in a parallel_for, or 0 outside of one.
+thread_local size_t thread_share_ = 0;
+
+// A run_on_pool call. Guarded by the mutex of the pool.
+struct Job {
+  size_t num_ranges;
+  void (*run)(const void*, size_t);
+  const void* context;
+  size_t next = 0;  // The first range that no thread took.
+  size_t done = 0;
+};
+
+// The waits are on atomic counters (futexes) rather than condition
+// variables. Both counters change under the mutex, so a waiter that read one
+// under the mutex does not miss the change it waits for.
+class Pool {
+ public:
+  explicit Pool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; ++i) {
+      m_workers.emplace_back([this]() { work(); });
+    }
+  }
+  ~Pool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+      ++m_submitted;
+    }
+    m_submitted.notify_all();
+    for (auto& worker : m_workers) worker.join();
+  }
+
+  void run(Job& job) {
+    std::unique_lock lock(m_mutex);
+    m_jobs.push_back(&job);
+    ++m_submitted;
+    m_submitted.notify_all();
+    while (job.next < job.num_ranges) run_range(job, lock);
+    while (job.done < job.num_ranges) wait(m_completed, lock);
+  }
+
+ private:
+  static void wait(std::atomic<size_t>& counter,
+                   std::unique_lock<std::mutex>& lock) {
+    const size_t old = counter.load();
+    lock.unlock();
+    counter.wait(old);
+    lock.lock();
+  }
+
+  // Takes the next range of the job and runs it, unlocked.
+  void run_range(Job& job, std::unique_lock<std::mutex>& lock) {
+    const size_t t = job.next++;
+    if (job.next == job.num_ranges) std::erase(m_jobs, &job);
+    lock.unlock();
+    job.run(job.context, t);
+    lock.lock();
+    ++job.done;
+    ++m_completed;
+    m_completed.notify_all();
+  }
+
+  void work() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+      while (!m_stop && m_jobs.empty()) wait(m_submitted, lock);
+      if (m_stop) return;
+      run_range(*m_jobs.front(), lock);
+    }
+  }
+
+  std::mutex m_mutex;
+  std::deque<Job*> m_jobs;
+  bool m_stop = false;
+  std::atomic<size_t> m_submitted = 0, m_completed = 0;
+  std::vector<std::thread> m_workers;
+};
+
+std::mutex pool_mutex;
+std::unique_ptr<Pool> pool_;  // Guarded by pool_mutex.
+}  // namespace
+
+void parallel::set_num_threads(size_t num_threads) {
+  ASSERT_FATAL(num_threads > 0);
+  std::lock_guard lock(pool_mutex);
+  if (num_threads != num_threads_) pool_.reset();  // Joins the idle workers.
+  num_threads_ = num_threads;
+}
+
+size_t parallel::get_num_threads() {
+  return thread_share_ != 0 ? thread_share_ : num_threads_.load();
+}
+
+parallel::details::ThreadShare::ThreadShare(size_t num_threads)
+    : m_previous(thread_share_) {
+  thread_share_ = num_threads;
+}
+
+parallel::details::ThreadShare::~ThreadShare() { thread_share_ = m_previous; }
+
+void parallel::details::run_on_pool(size_t num_ranges,
+                                    void (*run)(const void*, size_t),
+                                    const void* context) {
+  Pool* pool;
+  {
+    std::lock_guard lock(pool_mutex);
+    if (!pool_) pool_ = std::make_unique<Pool>(num_threads_ - 1);
+    pool = pool_.get();
+  }
+  Job job{num_ranges, run, context};
+  pool->run(job);
+}
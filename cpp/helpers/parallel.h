@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+
+namespace parallel {
+// Global execution context: the number of threads used by the parallel parts
+// of the pipeline. Defaults to the number of cores.
+void set_num_threads(size_t num_threads);
+// Within a range of parallel_for, the share of the threads of that range.
+size_t get_num_threads();
+
+namespace details {
+// Sets the get_num_threads() of the current thread while alive.
+class ThreadShare {
+ public:
+  explicit ThreadShare(size_t num_threads);
+  ~ThreadShare();
+  ThreadShare(const ThreadShare&) = delete;
+  ThreadShare& operator=(const ThreadShare&) = delete;
+
+ private:
+  size_t m_previous;
+};
+
+// Calls run(context, t) for every t in [0, num_ranges), concurrently on the
+// workers of a persistent pool (set_num_threads() - 1 of them, created on
+// first use) and on the calling thread. The caller also runs the ranges that
+// no worker took yet, so nested calls make progress even when all the
+// workers are busy. Returns when all the ranges are done. `run` must not
+// throw.
+void run_on_pool(size_t num_ranges, void (*run)(const void*, size_t),
+                 const void* context);
+}  // namespace details
+
+// Splits [0, num_tasks) to at most get_num_threads() contiguous ranges, such
+// that each range (except maybe the last) has at least `min_tasks_per_thread`
+// tasks, and calls `func(begin, end)` on every range concurrently (on the
+// thread pool, see details::run_on_pool). The ranges only depend on the number
+// of threads, not on which thread runs them.
+// The threads are split between the ranges, so parallel parts nested in func
+// do not oversubscribe the cores.
+// Blocks until all the ranges are done. Exceptions are rethrown in the caller.
+template <typename Func>
+void parallel_for(size_t num_tasks, Func&& func,
+                  size_t min_tasks_per_thread = 1) {
+  const size_t total_threads = get_num_threads();
+  size_t num_threads = std::min(
+      total_threads, num_tasks / std::max<size_t>(min_tasks_per_thread, 1));
+  if (num_threads <= 1) {
+    if (num_tasks != 0) func(size_t(0), num_tasks);
+    return;
+  }
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto run = [&](size_t t) {
+    const details::ThreadShare share(total_threads * (t + 1) / num_threads -
+                                     total_threads * t / num_threads);
+    try {
+      func(num_tasks * t / num_threads, num_tasks * (t + 1) / num_threads);
+    } catch (...) {
+      std::lock_guard lock(error_mutex);
+      if (!error) error = std::current_exception();
+    }
+  };
+  details::run_on_pool(
+      num_threads,
+      [](const void* context, size_t t) {
+        (*static_cast<const decltype(run)*>(context))(t);
+      },
+      &run);
+  if (error) std::rethrow_exception(error);
+}
+}  // namespace parallel
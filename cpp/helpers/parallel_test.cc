@@ -0,0 +1,80 @@
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(parallel, parallel_for_covers_range) {
+  const size_t num_threads = parallel::get_num_threads();
+  for (size_t threads : {1, 2, 7}) {
+    parallel::set_num_threads(threads);
+    for (size_t n : {0, 1, 5, 1000}) {
+      std::vector<int> hits(n);
+      parallel::parallel_for(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) ++hits[i];
+      });
+      EXPECT_EQ(hits, std::vector<int>(n, 1));
+    }
+  }
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(parallel, parallel_for_rethrows) {
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(4);
+  EXPECT_ANY_THROW(parallel::parallel_for(100, [](size_t begin, size_t) {
+    if (begin != 0) throw std::runtime_error("failed");
+  }));
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(parallel, parallel_for_splits_threads) {
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(7);
+  std::vector<size_t> shares(3);
+  parallel::parallel_for(shares.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      shares[i] = parallel::get_num_threads();
+    }
+  });
+  EXPECT_EQ(shares, (std::vector<size_t>{2, 2, 3}));
+  EXPECT_EQ(parallel::get_num_threads(), 7);
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(parallel, parallel_for_reuses_threads) {
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(4);
+  std::mutex mutex;
+  std::set<std::thread::id> ids;
+  for (size_t call = 0; call < 100; ++call) {
+    parallel::parallel_for(4, [&](size_t, size_t) {
+      std::lock_guard lock(mutex);
+      ids.insert(std::this_thread::get_id());
+    });
+  }
+  // The caller and the 3 workers of the pool.
+  EXPECT_LE(ids.size(), 4);
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(parallel, parallel_for_nested) {
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(8);
+  // Every outer range runs an inner parallel_for on its share of the pool.
+  std::vector<std::atomic<int>> hits(3 * 1000);
+  parallel::parallel_for(3, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      parallel::parallel_for(1000, [&](size_t inner_begin, size_t inner_end) {
+        for (size_t j = inner_begin; j < inner_end; ++j) ++hits[i * 1000 + j];
+      });
+    }
+  });
+  for (size_t i = 0; i < hits.size(); ++i) ASSERT_EQ(hits[i], 1) << i;
+  parallel::set_num_threads(num_threads);
+}
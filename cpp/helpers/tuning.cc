@@ -0,0 +1,84 @@
+#include "tuning.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#include "assertion.h"
+
+namespace {
+bool is_power_of_2(size_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+void validate(const tuning::Params& params) {
+  ASSERT_FATAL(is_power_of_2(params.ntt_chunk_size) &&
+               params.ntt_chunk_size <= tuning::max_ntt_chunk_size);
+  ASSERT_FATAL(is_power_of_2(params.ntt_parallel_blocks) &&
+               params.ntt_parallel_blocks <= tuning::max_ntt_parallel_blocks);
+  ASSERT_FATAL(
+      params.bit_reverse_lg2_chunk >= tuning::min_bit_reverse_lg2_chunk &&
+      params.bit_reverse_lg2_chunk <= tuning::max_bit_reverse_lg2_chunk);
+}
+
+std::mutex mutex;
+tuning::Params& current() {
+  static tuning::Params params = []() {
+    const std::string path = tuning::default_path();
+    if (path.empty() || !std::filesystem::exists(path)) {
+      return tuning::Params();
+    }
+    return tuning::load(path);
+  }();
+  return params;
+}
+}  // namespace
+
+tuning::Params tuning::get() {
+  std::lock_guard lock(mutex);
+  return current();
+}
+
+void tuning::set(const Params& params) {
+  validate(params);
+  std::lock_guard lock(mutex);
+  current() = params;
+}
+
+std::string tuning::default_path() {
+  if (const char* path = std::getenv("COUNTPRIMES_TUNING")) return path;
+  if (const char* home = std::getenv("HOME")) {
+    return std::string(home) + "/.countprimes_tuning";
+  }
+  return "";
+}
+
+tuning::Params tuning::load(const std::string& path) {
+  std::ifstream in(path);
+  ASSERT_FATAL(in.good());
+  Params params;
+  std::string name;
+  size_t value;
+  while (in >> name >> value) {
+    if (name == "ntt_chunk_size") {
+      params.ntt_chunk_size = value;
+    } else if (name == "ntt_parallel_blocks") {
+      params.ntt_parallel_blocks = value;
+    } else if (name == "bit_reverse_lg2_chunk") {
+      params.bit_reverse_lg2_chunk = value;
+    } else {
+      ASSERT_FATAL(false);  // Unknown parameter.
+    }
+  }
+  ASSERT_FATAL(in.eof());
+  validate(params);
+  return params;
+}
+
+void tuning::save(const Params& params, const std::string& path) {
+  validate(params);
+  std::ofstream out(path);
+  out << "ntt_chunk_size " << params.ntt_chunk_size << "\n"
+      << "ntt_parallel_blocks " << params.ntt_parallel_blocks << "\n"
+      << "bit_reverse_lg2_chunk " << params.bit_reverse_lg2_chunk << "\n";
+  ASSERT_FATAL(out.good());
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace tuning {
+// Block parameters of the kernels that depend on the host (cache and
+// register sizes). `countprimes --tune` measures the best ones and saves
+// them to default_path(), which the library loads on the first get().
+struct Params {
+  // The NTT loads the twiddles in chunks of this size...
+  size_t ntt_chunk_size = 8;
+  // ...and reuses each chunk across this many blocks.
+  size_t ntt_parallel_blocks = 4;
+  // Bit reversal swaps tiles of 2^lg2_chunk x 2^lg2_chunk elements, through
+  // buffers of that size (two per thread).
+  size_t bit_reverse_lg2_chunk = 4;
+
+  bool operator==(const Params&) const = default;
+};
+
+constexpr size_t max_ntt_chunk_size = 64;
+constexpr size_t max_ntt_parallel_blocks = 64;
+constexpr size_t min_bit_reverse_lg2_chunk = 2;
+constexpr size_t max_bit_reverse_lg2_chunk = 5;
+
+// Thread-safe. Set it before computing (it is read once per transform).
+Params get();
+void set(const Params& params);
+
+// $COUNTPRIMES_TUNING if set, otherwise $HOME/.countprimes_tuning.
+std::string default_path();
+// The file has a "name value" line per parameter, missing ones keep their
+// defaults.
+Params load(const std::string& path);
+void save(const Params& params, const std::string& path);
+}  // namespace tuning
@@ -0,0 +1,41 @@
+#include "tuning.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+TEST(tuning, save_and_load) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "countprimes_tuning_test")
+          .string();
+  tuning::Params params;
+  params.ntt_chunk_size = 32;
+  params.ntt_parallel_blocks = 1;
+  params.bit_reverse_lg2_chunk = 5;
+  tuning::save(params, path);
+  EXPECT_EQ(tuning::load(path), params);
+
+  // Missing parameters keep their defaults.
+  std::ofstream(path) << "ntt_chunk_size 16\n";
+  tuning::Params expected;
+  expected.ntt_chunk_size = 16;
+  EXPECT_EQ(tuning::load(path), expected);
+
+  std::ofstream(path) << "ntt_chunk_size 12\n";
+  EXPECT_ANY_THROW(tuning::load(path));
+  std::ofstream(path) << "unknown 1\n";
+  EXPECT_ANY_THROW(tuning::load(path));
+  std::filesystem::remove(path);
+}
+
+TEST(tuning, set) {
+  const tuning::Params initial = tuning::get();
+  tuning::Params params;
+  params.bit_reverse_lg2_chunk = 2;
+  tuning::set(params);
+  EXPECT_EQ(tuning::get(), params);
+  params.bit_reverse_lg2_chunk = 1;
+  EXPECT_ANY_THROW(tuning::set(params));
+  tuning::set(initial);
+}
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "../helpers/assertion.h"
+#include "../helpers/parallel.h"
+#include "../helpers/tuning.h"
 
 namespace details::bit_reverse {
 inline constexpr size_t bit_reverse_naive(size_t i, size_t n) {
@@ -41,8 +45,7 @@ void bit_reverse_naive(std::vector<T>& v) {
   }
 }
 
-template <typename T>
-void bit_reverse_impl_small(std::vector<T>& v) {
+void bit_reverse_impl_small(auto& v) {
   const size_t n = v.size();
   ASSERT_FATAL((n & (n - 1)) == 0);
   const auto lg2_n = __builtin_ctzll(n);
@@ -66,60 +69,74 @@ consteval auto get_reverse_table() {
 }
 }  // namespace details::bit_reverse
 
-template <typename T>
-void bit_reverse_impl(std::vector<T>& v) {
+// Cache-blocked (COBRA) bit reversal: An index is (a, mid, c) with a and c of
+// lg2_chunk bits, so that rev(a, mid, c) = (rev(c), rev(mid), rev(a)). For
+// each pair mid <= rev(mid), the tiles v[*, mid, *] and v[*, rev(mid), *]
+// (2^lg2_chunk rows of 2^lg2_chunk contiguous elements) are copied to buffers
+// and written back transposed to each other's place. The buffers avoid the
+// cache conflicts between the rows (which are n / 2^lg2_chunk apart). The
+// best size depends on the host (see tuning::Params). The pairs are spread
+// across the threads.
+template <size_t lg2_chunk>
+void bit_reverse_impl(auto& v) {
+  using T = std::remove_reference_t<decltype(v[0])>;
   const size_t n = v.size();
   ASSERT_FATAL((n & (n - 1)) == 0);
   const size_t lg2_n = __builtin_ctzll(n);
 
-  constexpr size_t lg2_chunk = 3;
-  // For my computer seems that 3 is optimal.
-  // TODO: Need to calibrate for different systems.
   if (lg2_n < 2 * lg2_chunk) return bit_reverse_impl_small(v);
 
   using namespace details::bit_reverse;
   constexpr auto rev = get_reverse_table<lg2_chunk>();
   constexpr size_t chunk = 1 << lg2_chunk;
+  const size_t num_mids = n >> (2 * lg2_chunk);
+  const size_t lg2_row = lg2_n - lg2_chunk;
+  T* data = v.data();
 
-  size_t chunk_end = n >> lg2_chunk;
-  size_t lg2_end = __builtin_ctzll(chunk_end);
-
-  size_t next_mid_rev = 0;
-  for (size_t mid = 0, mid_rev = 0; mid < chunk_end;
-       mid += chunk, mid_rev = next_mid_rev) {
-    size_t bit = chunk_end >> 1;
-    while (bit & next_mid_rev) {
-      next_mid_rev ^= bit;
-      bit >>= 1;
+  auto load = [&](size_t mid, T* buffer) {
+    for (size_t a = 0; a < chunk; ++a) {
+      const T* row = data + (a << lg2_row) + (mid << lg2_chunk);
+      std::copy(row, row + chunk, buffer + a * chunk);
     }
-    next_mid_rev ^= bit;
-
-    if (mid > mid_rev) continue;
-    if (mid == mid_rev) {
-      for (size_t i = 0; i < chunk; ++i) {
-        size_t i_rev = rev[i];
-        for (size_t j = 0; j < chunk; ++j) {
-          size_t j_rev = rev[j];
-          size_t idx1 = (i << lg2_end) + mid + j;
-          size_t idx2 = (j_rev << lg2_end) + mid + i_rev;
-          if (j_rev < i) std::swap(v[idx1], v[idx2]);
-        }
-      }
-    } else {
-      for (size_t i = 0; i < chunk; ++i) {
-        size_t i_rev = rev[i];
-        for (size_t j = 0; j < chunk; ++j) {
-          size_t j_rev = rev[j];
-          size_t idx1 = (i << lg2_end) + mid + j;
-          size_t idx2 = (j_rev << lg2_end) + mid_rev + i_rev;
-          std::swap(v[idx1], v[idx2]);
-        }
-      }
+  };
+  // Writes the tile at mid, whose elements are rev(c), rev(mid), rev(a).
+  auto store = [&](size_t mid, const T* buffer) {
+    for (size_t a = 0; a < chunk; ++a) {
+      T* row = data + (a << lg2_row) + (mid << lg2_chunk);
+      const T* column = buffer + rev[a];
+      for (size_t c = 0; c < chunk; ++c) row[c] = column[rev[c] * chunk];
     }
-  }
+  };
+  parallel::parallel_for(
+      num_mids,
+      [&](size_t begin, size_t end) {
+        std::array<T, (1ull << (2 * lg2_chunk))> buffer1, buffer2;
+        for (size_t mid = begin; mid < end; ++mid) {
+          const size_t mid_rev = bit_reverse(mid, num_mids);
+          if (mid > mid_rev) continue;
+          load(mid, buffer1.data());
+          if (mid == mid_rev) {
+            store(mid, buffer1.data());
+          } else {
+            load(mid_rev, buffer2.data());
+            store(mid, buffer2.data());
+            store(mid_rev, buffer1.data());
+          }
+        }
+      },
+      (1ull << 14) >> (2 * lg2_chunk));
 }
 
-template <typename T>
-void inplace_bit_reverse(std::vector<T>& v) {
-  bit_reverse_impl(v);
+void inplace_bit_reverse(auto& v) {
+  switch (tuning::get().bit_reverse_lg2_chunk) {
+    case 2:
+      return bit_reverse_impl<2>(v);
+    case 3:
+      return bit_reverse_impl<3>(v);
+    case 4:
+      return bit_reverse_impl<4>(v);
+    case 5:
+      return bit_reverse_impl<5>(v);
+  }
+  ASSERT_FATAL(false);  // Not a valid tuning::Params.
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <numeric>
 #include <vector>
 
+#include "../helpers/parallel.h"
+
 TEST(bit_reverse, test_reverse_array) {
   std::vector<int> v(1 << 16);
   std::iota(v.begin(), v.end(), 0);
@@ -16,4 +18,29 @@ TEST(bit_reverse, test_reverse_array) {
   inplace_bit_reverse(v2);
   EXPECT_EQ(v1, expected);
   EXPECT_EQ(v2, expected);
-}
\ No newline at end of file
+}
+template <size_t lg2_chunk>
+void test_bit_reverse_impl(const std::vector<int>& v,
+                           const std::vector<int>& expected) {
+  auto res = v;
+  bit_reverse_impl<lg2_chunk>(res);
+  EXPECT_EQ(res, expected) << lg2_chunk;
+}
+
+TEST(bit_reverse, test_tiles_and_threads) {
+  const size_t num_threads = parallel::get_num_threads();
+  for (size_t lg2_n : {0, 3, 9, 10, 17}) {
+    std::vector<int> v(1 << lg2_n);
+    std::iota(v.begin(), v.end(), 0);
+    auto expected = v;
+    bit_reverse_naive(expected);
+    for (size_t threads : {1, 3, 8}) {
+      parallel::set_num_threads(threads);
+      test_bit_reverse_impl<2>(v, expected);
+      test_bit_reverse_impl<3>(v, expected);
+      test_bit_reverse_impl<4>(v, expected);
+      test_bit_reverse_impl<5>(v, expected);
+    }
+  }
+  parallel::set_num_threads(num_threads);
+}
@@ -0,0 +1,155 @@
+#include "mobius_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+
+#include "../helpers/assertion.h"
+#include "../helpers/cell.h"
+#include "../helpers/mapped_vector.h"
+#include "mobius_using_newton.h"
+
+namespace {
+std::string dir_ = []() -> std::string {
+  const char* dir = std::getenv("COUNTPRIMES_MOBIUS_CACHE");
+  return dir ? dir : "";
+}();
+
+constexpr char magic[8] = "CPMOBV2";
+
+// The cells follow it, a cache line aligned.
+struct alignas(64) Header {
+  char magic[8];
+  uint64_t mod;
+  uint64_t mint_bytes;
+  uint64_t upto;
+  double lg2_prec;
+  uint64_t max_prime;
+  uint64_t max_cell;
+};
+
+template <typename mint_t>
+Header make_header(prime_t upto, double lg2_prec, prime_t max_prime,
+                   size_t max_cell) {
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.mod = mint_t::get_mod();
+  header.mint_bytes = sizeof(mint_t);
+  header.upto = upto;
+  header.lg2_prec = lg2_prec;
+  header.max_prime = max_prime;
+  header.max_cell = max_cell;
+  return header;
+}
+
+// The cells of the file at `path`, if it is a cache file of these parameters.
+// Anything else is a miss.
+template <typename mint_t>
+std::optional<mobius_cache::MobiusCells<mint_t>> load(const std::string& path,
+                                                      const Header& expected) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) return std::nullopt;
+  struct stat st;
+  const bool ok = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header);
+  void* p = ok ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0)
+               : MAP_FAILED;
+  close(fd);
+  if (p == MAP_FAILED) return std::nullopt;
+  const size_t bytes = st.st_size;
+  std::shared_ptr<const void> owner(
+      p, [bytes](const void* p) { munmap(const_cast<void*>(p), bytes); });
+
+  const auto& header = *static_cast<const Header*>(p);
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+      header.mod != expected.mod || header.mint_bytes != expected.mint_bytes ||
+      header.upto != expected.upto || header.lg2_prec != expected.lg2_prec ||
+      header.max_prime != expected.max_prime ||
+      header.max_cell != expected.max_cell ||
+      bytes != sizeof(Header) + (header.max_cell + 1) * sizeof(mint_t)) {
+    return std::nullopt;
+  }
+  const auto* cells = reinterpret_cast<const mint_t*>(&header + 1);
+  return mobius_cache::MobiusCells<mint_t>{
+      std::move(owner), std::span(cells, expected.max_cell + 1)};
+}
+
+// Writes a temporary file and renames it, so readers (also of other
+// processes) see either the old file or the new one. Returns false if it
+// failed, without leaving the temporary file.
+template <typename mint_t>
+bool save(const std::string& path, const Header& header,
+          std::span<const mint_t> cells) {
+  const std::string tmp_path = path + ".tmp" + std::to_string(getpid());
+  bool ok;
+  {
+    std::ofstream out(tmp_path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(cells.data()), cells.size_bytes());
+    out.close();
+    ok = !out.fail();
+  }
+  ok = ok && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+  if (!ok) std::remove(tmp_path.c_str());
+  return ok;
+}
+}  // namespace
+
+void mobius_cache::set_dir(const std::string& dir) { dir_ = dir; }
+
+const std::string& mobius_cache::get_dir() { return dir_; }
+
+std::string mobius_cache::details::get_path(const std::string& dir,
+                                            uint64_t mod, prime_t upto,
+                                            double lg2_prec,
+                                            prime_t max_prime) {
+  // lg2_prec by its bits, the cells change with any of them.
+  char name[128];
+  std::snprintf(name, sizeof(name), "/mobius-%lu-%ld-%016lx-%ld.bin",
+                static_cast<unsigned long>(mod), static_cast<long>(upto),
+                static_cast<unsigned long>(std::bit_cast<uint64_t>(lg2_prec)),
+                static_cast<long>(max_prime));
+  return dir + name;
+}
+
+template <typename mint_t>
+mobius_cache::MobiusCells<mint_t> mobius_cache::get_mobius(prime_t upto,
+                                                           double lg2_prec,
+                                                           prime_t max_prime) {
+  const size_t max_cell = get_cell(upto, lg2_prec);
+  const Header header =
+      make_header<mint_t>(upto, lg2_prec, max_prime, max_cell);
+  const std::string path =
+      dir_.empty() ? ""
+                   : details::get_path(dir_, mint_t::get_mod(), upto, lg2_prec,
+                                       max_prime);
+  if (!path.empty()) {
+    if (auto cached = load<mint_t>(path, header)) return std::move(*cached);
+  }
+  auto mobius = std::make_shared<mapped_vector<mint_t>>(
+      get_mobius_using_newton<mint_t>(upto, lg2_prec, max_prime));
+  ASSERT_FATAL(mobius->size() > max_cell);
+  const std::span<const mint_t> cells(mobius->data(), max_cell + 1);
+  // The cache is best effort, the cells are still returned.
+  if (!path.empty() && !save(path, header, cells)) {
+    std::cerr << "Warning: could not save the Mobius cells to " << path
+              << std::endl;
+  }
+  return {std::move(mobius), cells};
+}
+
+namespace mobius_cache {
+template MobiusCells<mint> get_mobius(prime_t, double, prime_t);
+template MobiusCells<mint2> get_mobius(prime_t, double, prime_t);
+template MobiusCells<mint3> get_mobius(prime_t, double, prime_t);
+template MobiusCells<mint32> get_mobius(prime_t, double, prime_t);
+template MobiusCells<mint32_2> get_mobius(prime_t, double, prime_t);
+}  // namespace mobius_cache
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "../helpers/mod_int.h"
+#include "../helpers/types.h"
+
+/**
+ * On-disk cache of the finished Mobius cell vectors, for repeated queries.
+ * A file holds the cells 0..max_cell of get_mobius_using_newton for a modulus,
+ * upto, lg2_prec and max_prime, and serves the queries with all of them (upto
+ * also picks the prime ranges and the powers the cells are computed with). The
+ * files are memory-mapped read only, without copying.
+ */
+namespace mobius_cache {
+// The directory of the files, empty disables the cache. Defaults to
+// $COUNTPRIMES_MOBIUS_CACHE if set. Set it before computing.
+void set_dir(const std::string& dir);
+const std::string& get_dir();
+
+// The cells of a Mobius vector, read only. `owner` keeps them alive (the
+// computed vector, or the mapping of the file).
+template <typename mint_t>
+struct MobiusCells {
+  std::shared_ptr<const void> owner;
+  std::span<const mint_t> cells;
+
+  const mint_t& operator[](size_t i) const { return cells[i]; }
+  size_t size() const { return cells.size(); }
+};
+
+// The cells 0..get_cell(upto, lg2_prec) of
+// get_mobius_using_newton<mint_t>(upto, lg2_prec, max_prime), from the cache
+// if a file holds them. Otherwise computes them, and saves them unless the
+// cache is disabled (a failed save only logs a warning).
+// Instantiated for the NttModInts (see helpers/moduli.h).
+template <typename mint_t = mint>
+MobiusCells<mint_t> get_mobius(prime_t upto, double lg2_prec,
+                               prime_t max_prime);
+
+namespace details {
+// The path of the file of these parameters in `dir`.
+std::string get_path(const std::string& dir, uint64_t mod, prime_t upto,
+                     double lg2_prec, prime_t max_prime);
+}  // namespace details
+}  // namespace mobius_cache
@@ -0,0 +1,129 @@
+#include "mobius_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "../helpers/cell.h"
+#include "../helpers/mod_int.h"
+#include "../helpers/types.h"
+#include "mobius_using_newton.h"
+
+namespace {
+template <typename mint_t>
+std::vector<mint_t> to_vector(const mobius_cache::MobiusCells<mint_t>& v) {
+  return std::vector<mint_t>(v.cells.begin(), v.cells.end());
+}
+
+template <typename mint_t>
+std::vector<mint_t> get_expected(prime_t upto, double lg2_prec,
+                                 prime_t max_prime) {
+  auto res = get_mobius_using_newton<mint_t>(upto, lg2_prec, max_prime);
+  res.resize(get_cell(upto, lg2_prec) + 1);
+  return std::vector<mint_t>(res.begin(), res.end());
+}
+}  // namespace
+
+TEST(mobius_cache, repeated_queries) {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "countprimes_mobius_cache_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directory(dir);
+  mobius_cache::set_dir(dir.string());
+  constexpr double lg2_prec = 0.01;
+  constexpr prime_t max_prime = 30'000;
+  constexpr prime_t upto = 100'000'000;
+  const auto path = mobius_cache::details::get_path(
+      dir.string(), mint32::get_mod(), upto, lg2_prec, max_prime);
+
+  // Computed and saved.
+  auto expected = get_expected<mint32>(upto, lg2_prec, max_prime);
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(upto, lg2_prec,
+                                                       max_prime)),
+            expected);
+  ASSERT_TRUE(std::filesystem::exists(path));
+  const auto file_size = std::filesystem::file_size(path);
+
+  // Mapped from the file.
+  auto cached = mobius_cache::get_mobius<mint32>(upto, lg2_prec, max_prime);
+  // The cells start after the header, at the beginning of the mapping.
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(cached.cells.data()) % 4096, 64);
+  EXPECT_EQ(to_vector(cached), expected);
+
+  // Another modulus, upto or max_prime has its own file.
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint>(upto, lg2_prec,
+                                                     max_prime)),
+            get_expected<mint>(upto, lg2_prec, max_prime));
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(upto / 1000, lg2_prec,
+                                                       max_prime)),
+            get_expected<mint32>(upto / 1000, lg2_prec, max_prime));
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(upto, lg2_prec,
+                                                       max_prime / 2)),
+            get_expected<mint32>(upto, lg2_prec, max_prime / 2));
+  EXPECT_EQ(std::filesystem::file_size(path), file_size);
+
+  // An invalid file is a miss, and is replaced.
+  std::ofstream(path) << "not a cache file";
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(upto, lg2_prec,
+                                                       max_prime)),
+            expected);
+  EXPECT_EQ(std::filesystem::file_size(path), file_size);
+
+  mobius_cache::set_dir("");
+  std::filesystem::remove_all(dir);
+}
+
+// The same cells, but 1025^2 changes the powers of the first prime range.
+TEST(mobius_cache, schedule_change) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   "countprimes_mobius_cache_schedule_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directory(dir);
+  mobius_cache::set_dir(dir.string());
+  constexpr double lg2_prec = 0.01;
+  constexpr prime_t max_prime = 30'000;
+  constexpr prime_t upto = 1025 * 1025;
+  ASSERT_EQ(get_cell(upto - 1, lg2_prec), get_cell(upto, lg2_prec));
+  ASSERT_NE(mobius::details::get_prime_ranges(upto - 1, lg2_prec, max_prime)
+                .front()
+                .max_cell,
+            mobius::details::get_prime_ranges(upto, lg2_prec, max_prime)
+                .front()
+                .max_cell);
+
+  for (int repeat = 0; repeat < 2; ++repeat) {
+    for (prime_t query : {upto - 1, upto}) {
+      EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(query, lg2_prec,
+                                                           max_prime)),
+                get_expected<mint32>(query, lg2_prec, max_prime));
+    }
+  }
+  for (prime_t query : {upto - 1, upto}) {
+    EXPECT_TRUE(std::filesystem::exists(mobius_cache::details::get_path(
+        dir.string(), mint32::get_mod(), query, lg2_prec, max_prime)));
+  }
+
+  mobius_cache::set_dir("");
+  std::filesystem::remove_all(dir);
+}
+
+// A failed save leaves no file, and still returns the cells.
+TEST(mobius_cache, unwritable_dir) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   "countprimes_mobius_cache_missing_dir";
+  std::filesystem::remove_all(dir);
+  mobius_cache::set_dir(dir.string());
+  constexpr double lg2_prec = 0.01;
+  constexpr prime_t max_prime = 30'000;
+  constexpr prime_t upto = 1'000'000;
+
+  EXPECT_EQ(to_vector(mobius_cache::get_mobius<mint32>(upto, lg2_prec,
+                                                       max_prime)),
+            get_expected<mint32>(upto, lg2_prec, max_prime));
+  EXPECT_FALSE(std::filesystem::exists(dir));
+
+  mobius_cache::set_dir("");
+}
@@ -1,9 +1,14 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
+#include "../helpers/cell.h"
+#include "../helpers/mapped_vector.h"
 #include "../helpers/mod_int.h"
+#include "../helpers/parallel.h"
+#include "../helpers/sieve_primes.h"
 #include "../helpers/types.h"
 #include "mobius_using_newton.h"
 #include "naive_mobius.h"
@@ -19,7 +24,8 @@ TEST(mobius, test_naive_mobius) {
 }
 
 void test_newton_mobius(prime_t upto, double lg2_prec, prime_t max_prime) {
-  auto res = get_mobius_using_newton(upto, lg2_prec, max_prime);
+  auto res_ = get_mobius_using_newton(upto, lg2_prec, max_prime);
+  std::vector<mint> res(res_.begin(), res_.end());
   auto expected_ = get_mobius_by_factoring<int32_t>(upto, lg2_prec, max_prime);
   std::vector<mint> expected(expected_.begin(), expected_.end());
   size_t n = std::max(res.size(), expected.size());
@@ -38,3 +44,83 @@ TEST(mobius, test_newton_mobius_large) {
 TEST(mobius, test_newton_mobius_small) {
   test_newton_mobius(10, /*lg2_prec=*/1, /*max_prime=*/10);
 }
+
+TEST(mobius, test_newton_mobius_parallel) {
+  // Large enough for the Newton identities to run on several threads.
+  constexpr prime_t upto = 1'000'000;
+  constexpr double lg2_prec = 0.0002;
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(1);
+  auto expected = get_mobius_using_newton(upto, lg2_prec, upto);
+  for (size_t threads : {2, 3, 8}) {
+    parallel::set_num_threads(threads);
+    EXPECT_EQ(get_mobius_using_newton(upto, lg2_prec, upto), expected);
+  }
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(mobius, test_newton_mobius_memory_budget) {
+  // Several prime ranges (the small primes have 3 powers up to upto),
+  // computed one at a time or concurrently.
+  constexpr prime_t upto = 1'100'000'000, max_prime = 4'000'000;
+  constexpr double lg2_prec = 0.02;
+  const size_t num_threads = parallel::get_num_threads();
+  parallel::set_num_threads(4);
+  auto expected = get_mobius_using_newton(upto, lg2_prec, max_prime);
+  for (size_t budget : {1ull << 16, 1ull << 40}) {
+    storage::set_memory_budget(budget);
+    EXPECT_EQ(get_mobius_using_newton(upto, lg2_prec, max_prime), expected);
+  }
+  storage::set_memory_budget(0);
+  parallel::set_num_threads(num_threads);
+}
+
+TEST(mobius, test_newton_mobius_prime_ranges) {
+  // The primes above split_prime have no products up to upto, so they
+  // multiply the mobius of the others by 1 - sum of x^cell(p). Up to
+  // split_prime there is a single prime range, and up to max_prime there are
+  // more, the last of them short.
+  constexpr prime_t upto = 1'100'000'000, split_prime = 1'000'000,
+                    max_prime = 4'000'000;
+  constexpr double lg2_prec = 0.02;
+  const size_t max_cell = get_cell(upto, lg2_prec);
+  auto expected_ = get_mobius_using_newton(upto, lg2_prec, split_prime);
+  std::vector<mint> expected(expected_.begin(),
+                             expected_.begin() + max_cell + 1);
+  std::vector<mint> num_primes(max_cell + 1);
+  for (prime_t p : get_primes_by_sieve(max_prime, split_prime + 1)) {
+    ASSERT_GT(get_cell(p, lg2_prec) * 2, max_cell);
+    num_primes[get_cell(p, lg2_prec)] += 1;
+  }
+  for (size_t i = max_cell + 1; i-- > 0;) {
+    for (size_t cell = 1; cell <= i; ++cell) {
+      expected[i] -= num_primes[cell] * expected[i - cell];
+    }
+  }
+  auto res = get_mobius_using_newton(upto, lg2_prec, max_prime);
+  ASSERT_GT(res.size(), max_cell);
+  EXPECT_EQ(std::vector<mint>(res.begin(), res.begin() + max_cell + 1),
+            expected);
+}
+
+TEST(mobius, test_prime_ranges_ntt_size) {
+  // Max cells around the transform sizes 2^k and 3 * 2^k, where a range's
+  // inner max cell may reach the size (the first range is not cut by
+  // max_prime).
+  constexpr prime_t upto = 1'100'000'000, max_prime = 4'000'000;
+  for (size_t max_cell : {1023, 1024, 1501, 1535, 1536, 2047, 2048}) {
+    const double lg2_prec = std::log2(upto) / (max_cell + 0.5);
+    ASSERT_EQ(get_cell(upto, lg2_prec), max_cell);
+    const size_t mobius_sz = get_mobius_ntt_size(upto, lg2_prec);
+    const auto ranges =
+        mobius::details::get_prime_ranges(upto, lg2_prec, max_prime);
+    prime_t next_prime = mobius::details::max_prime_for_naive_conv + 1;
+    for (const auto& range : ranges) {
+      EXPECT_EQ(range.min_prime, next_prime);
+      EXPECT_LE(range.vec_sz, mobius_sz) << max_cell;
+      EXPECT_GT(range.vec_sz, range.max_cell);
+      next_prime = range.max_prime + 1;
+    }
+    EXPECT_EQ(next_prime, max_prime + 1);
+  }
+}
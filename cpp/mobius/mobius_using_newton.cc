@@ -1,21 +1,38 @@
 #include "mobius_using_newton.h"
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "../NTT/ntt.h"
 #include "../helpers/assertion.h"
 #include "../helpers/cell.h"
 #include "../helpers/indicators.h"
+#include "../helpers/mapped_vector.h"
 #include "../helpers/math.h"
+#include "../helpers/mint_span.h"
 #include "../helpers/mod_int.h"
+#include "../helpers/mod_int_simd.h"
+#include "../helpers/parallel.h"
 #include "../helpers/sieve_primes.h"
 #include "../helpers/types.h"
 
 namespace mobius::details {
+// Below this many coefs of the Newton identities a thread costs more than it
+// saves.
+constexpr size_t min_coefs_per_thread = 1ull << 12;
+// Bounds max_power, the number of prime factors of a number up to upto.
+constexpr size_t max_power_available = 1ull << 4;
+// The Newton identities read max_power tiles of this size (at most 2^4 * 2^11
+// elements, 256KB for 64-bit ModInts), which fit in L2.
+constexpr size_t lg2_newton_tile = 11;
+
 size_t get_max_power(prime_t upto, prime_t base) {
   prime_t v = 1;
   size_t ans = 0;
@@ -26,144 +43,445 @@ size_t get_max_power(prime_t upto, prime_t base) {
   return std::max<size_t>(ans, 1);
 }
 
-std::vector<mint> get_mobius_prime_range(prime_t upto, double lg2_prec,
-                                         prime_t min_prime, prime_t max_prime,
-                                         size_t vec_sz) {
+// The positions of primes_vec that a tile of positions [begin, begin + size)
+// of the transform reads (size a power of two dividing the power of two part
+// of vec_sz): The tile holds the frequencies i = i_0 + rev[s] * vec_sz / size
+// for the positions begin + s, and the coef of i * power is in the tile
+// block[power] at offset rev[(offset[power] + power * rev[s]) % size], where
+// rev is the bit reversal of [0, size).
+// So each power gathers from a single tile, and without the modulo of vec_sz.
+struct TileSources {
+  TileSources(size_t begin, size_t vec_sz, size_t max_power,
+              std::span<const uint32_t> rev) {
+    const size_t size = rev.size();
+    const size_t i_0 = bit_reversed_frequency(begin, vec_sz);
+    for (size_t power = 1; power <= max_power; ++power) {
+      const size_t position =
+          bit_reversed_position(i_0 * power % vec_sz, vec_sz);
+      block[power] = position - position % size;
+      offset[power] = rev[position % size];
+    }
+  }
+  std::array<size_t, max_power_available> block, offset;
+};
+
+// The mobius coefs of positions [begin, end) of a tile (see TileSources),
+// Pack::width positions at a time, one per lane, since they all run the same
+// recurrence. `mobius` points to the tile and `inv_mod` is normalized.
+// Returns the number of positions done (a multiple of Pack::width).
+template <typename Pack, typename mint_t = typename Pack::mint_t>
+size_t newton_identities_span(
+    const mint_t* primes_vec, mint_t* mobius, size_t begin, size_t end,
+    const TileSources& sources, std::span<const uint32_t> rev,
+    size_t max_power,
+    const std::array<mint_t, max_power_available>& inv_mod) {
+  constexpr size_t width = Pack::width;
+  const size_t mask = rev.size() - 1;
+  auto broadcast = [](mint_t x) {
+    std::array<mint_t, width> lanes;
+    lanes.fill(x);
+    return Pack::load(lanes.data());
+  };
+  Pack inv_packs[max_power_available];
+  for (size_t power = 1; power <= max_power; ++power) {
+    inv_packs[power] = broadcast(inv_mod[power]);
+  }
+  const Pack one = broadcast(1), zero = broadcast(0);
+
+  Pack prime_powers[max_power_available];
+  Pack unique_mults[max_power_available];
+  prime_powers[0] = unique_mults[0] = one;  // Only 1.
+  size_t s = begin;
+  for (; s + width <= end; s += width) {
+    {
+      std::array<size_t, width> rev_s;
+      for (size_t l = 0; l < width; ++l) rev_s[l] = rev[s + l];
+      std::array<mint_t, width> lanes;
+      for (size_t power = 1; power <= max_power; ++power) {
+        // We want the i-th fft coef from the array f' where a prime that
+        // was supposed to be in cell c, appears instead in the cell
+        // c*power. That is equivalent to: f'(w^i) = f(w^(i*power)).
+        const mint_t* block = primes_vec + sources.block[power];
+        const size_t offset = sources.offset[power];
+        for (size_t l = 0; l < width; ++l) {
+          lanes[l] = block[rev[(offset + power * rev_s[l]) & mask]];
+        }
+        prime_powers[power] = Pack::load(lanes.data());
+      }
+    }
+    {
+      unique_mults[1] = prime_powers[1];
+      for (size_t power = 2; power <= max_power; ++power) {
+        unique_mults[power] = prime_powers[power];
+        for (size_t k = power - 1; k > 0; --k) {
+          // Apply Newton's identities.
+          // The coef of unique_mults[power-1] * prime_power[1] should be 1.
+          unique_mults[power] =
+              prime_powers[k] * unique_mults[power - k] - unique_mults[power];
+        }
+        unique_mults[power] =
+            unique_mults[power].mul_normalized(inv_packs[power]);
+      }
+    }
+    {
+      Pack cur = zero;
+      for (int64_t power = max_power; power >= 0; power--) {
+        // We want unique_mults[0] * 1;
+        cur = unique_mults[power] - cur;
+      }
+      cur.store(mobius + s);
+    }
+  }
+  return s - begin;
+}
+
+template <typename mint_t>
+mapped_vector<mint_t> get_mobius_prime_range(prime_t upto, double lg2_prec,
+                                             prime_t min_prime,
+                                             prime_t max_prime,
+                                             size_t vec_sz) {
   size_t max_power =
       std::min(get_max_power(upto, min_prime), max_number_of_factors(upto));
-  std::vector<mint> primes_vec;
+  mapped_vector<mint_t> primes_vec;
   {
     // ComputePrimeVector
     primes_vec.resize(vec_sz);
     auto primes = get_primes_by_sieve(max_prime, min_prime);
     add_as_counter(primes_vec, primes, lg2_prec);
-    ntt(primes_vec, "Ntt of primes");
+    const size_t nonzero_size =
+        std::min(vec_sz, get_cell(max_prime, lg2_prec) + 1);
+    ntt_bit_reversed_pruned(primes_vec, nonzero_size, "Ntt of primes");
   }
 
-  std::vector<mint> mobius;
+  mapped_vector<mint_t> mobius;
   {
     // ComputeMobius
     mobius.resize(vec_sz);
-    constexpr size_t max_power_available = 1ull << 4;
     ASSERT_FATAL(max_power < max_power_available);
 
-    mint prime_powers[max_power_available];
-    mint unique_mults[max_power_available];
-    mint inv_mod[max_power_available];
-
+    std::array<mint_t, max_power_available> inv_mod;
     for (size_t i = 1; i < max_power_available; ++i) {
-      inv_mod[i] = mint(i).inverse();
+      (inv_mod[i] = mint_t(i).inverse()).normalize();
     }
 
-    prime_powers[0] = unique_mults[0] = 1;  // Only 1.
-
     const std::string title = std::string("Mobius (") +
                               std::to_string(min_prime) + ", " +
                               std::to_string(max_prime) + ")";
     tqdm::Title tq(title);
-    for (size_t i = 0; i < vec_sz; ++i) {
-      {
-        for (size_t power = 1; power <= max_power; ++power)
-          // We want the i-th fft coef from the array f' where a prime that
-          // was supposed to be in cell c, appears instead in the cell
-          // c*power. That is equivalent to: f'(w^i) = f(w^(i*power)).
-          prime_powers[power] = primes_vec[i * power % vec_sz];
-      }
-      {
-        unique_mults[1] = prime_powers[1];
-        for (size_t power = 2; power <= max_power; ++power) {
-          unique_mults[power] = prime_powers[power];
-          for (size_t k = power - 1; k > 0; --k) {
-            // Apply Newton's identities.
-            // The coef of unique_mults[power-1] * prime_power[1] should be 1.
-            unique_mults[power] =
-                prime_powers[k] * unique_mults[power - k] - unique_mults[power];
+    // The transforms are kept in bit reversed order, so position j holds
+    // the i-th fft coef for i = bit_reversed_frequency(j). The coefs are
+    // independent, and computed a tile at a time (see TileSources), which
+    // gathers from max_power tiles of primes_vec that stay in the cache.
+    const size_t tile_size =  // Divides vec_sz.
+        std::min<size_t>(1ull << lg2_newton_tile, vec_sz & -vec_sz);
+    std::vector<uint32_t> rev(tile_size);
+    for (size_t s = 0; s < tile_size; ++s) rev[s] = bit_reverse(s, tile_size);
+    parallel::parallel_for(
+        vec_sz / tile_size,
+        [&](size_t begin, size_t end) {
+          using Pack = simd::Pack<mint_t>;
+          for (size_t tile = begin; tile < end; ++tile) {
+            const size_t tile_begin = tile * tile_size;
+            const TileSources sources(tile_begin, vec_sz, max_power, rev);
+            mint_t* out = mobius.data() + tile_begin;
+            const size_t done = newton_identities_span<Pack>(
+                primes_vec.data(), out, 0, tile_size, sources, rev, max_power,
+                inv_mod);
+            newton_identities_span<simd::ScalarPack<mint_t>>(
+                primes_vec.data(), out, done, tile_size, sources, rev,
+                max_power, inv_mod);
           }
-          unique_mults[power] *= inv_mod[power];
-        }
+        },
+        min_coefs_per_thread / tile_size);
+  }
+  return mobius;
+}
+
+// If `multiplier` is not null (transformed, of size new_sz), the result is
+// multiplied by it, in the last pass of the NTT.
+template <typename mint_t>
+void truncate_and_resize(mapped_vector<mint_t>& v, size_t max_cell,
+                         size_t new_sz,
+                         const mapped_vector<mint_t>* multiplier = nullptr) {
+  ASSERT_FATAL(max_cell < new_sz);
+  const size_t kept_size = std::min(v.size(), max_cell + 1);
+  intt_bit_reversed_pruned(v, kept_size, "Truncate INTT");
+  for (size_t i = kept_size; i < std::min(v.size(), new_sz); ++i) v[i] = 0;
+  v.resize(new_sz);
+  if (multiplier) {
+    ntt_bit_reversed_multiply(v, *multiplier, kept_size, "Truncate NTT");
+  } else {
+    ntt_bit_reversed_pruned(v, kept_size, "Truncate NTT");
+  }
+}
+
+// A transformed factor of the product, as a polynomial it is zero in the
+// cells above `degree`.
+template <typename mint_t>
+struct Factor {
+  mapped_vector<mint_t> values;
+  size_t degree;
+};
+
+// a *= b, both of size mobius_sz afterwards, and correct in the cells up to
+// max_cell. A factor is truncated (an INTT and an NTT) only when the cyclic
+// product would otherwise wrap around, that is, factors of size mobius_sz
+// keep their cells above max_cell while the degrees add up below mobius_sz.
+template <typename mint_t>
+void multiply_factors(Factor<mint_t>& a, Factor<mint_t>& b, size_t max_cell,
+                      size_t mobius_sz) {
+  if (b.values.size() != mobius_sz ||
+      std::min(a.degree, max_cell) + b.degree >= mobius_sz) {
+    truncate_and_resize(b.values, max_cell, mobius_sz);
+    b.degree = std::min(b.degree, max_cell);
+  }
+  if (a.values.size() == mobius_sz && a.degree + b.degree < mobius_sz) {
+    parallel::parallel_for(
+        mobius_sz,
+        [&](size_t first, size_t last) {
+          mint_span::mul(std::span(a.values).subspan(first, last - first),
+                         std::span(b.values).subspan(first, last - first));
+        },
+        min_coefs_per_thread);
+  } else {
+    truncate_and_resize(a.values, max_cell, mobius_sz, &b.values);
+    a.degree = std::min(a.degree, max_cell);
+  }
+  a.degree += b.degree;
+}
+
+// The product of the get_mobius_prime_range of the ranges (transformed, in
+// bit reversed order, of size mobius_sz unless there is a single range).
+// The ranges are computed in waves, concurrently, as many as
+// storage::get_memory_budget allows (at least one), and each wave is
+// multiplied with the product so far as a tree. The live vectors are the
+// product and the ones of the wave.
+template <typename mint_t>
+mapped_vector<mint_t> multiply_prime_ranges(
+    prime_t upto, double lg2_prec, size_t max_cell, size_t mobius_sz,
+    std::span<const PrimeRange> ranges) {
+  ASSERT_FATAL(!ranges.empty());
+  auto compute = [&](const PrimeRange& range) {
+    return Factor<mint_t>{
+        get_mobius_prime_range<mint_t>(upto, lg2_prec, range.min_prime,
+                                       range.max_prime, range.vec_sz),
+        range.max_cell};
+  };
+  if (ranges.size() == 1) {
+    return compute(ranges[0]).values;  // No need to multiply or truncate.
+  }
+  // The primes and the mobius vectors, and the latter resized.
+  auto peak_bytes = [&](const PrimeRange& range) {
+    return (range.vec_sz + std::max(range.vec_sz, mobius_sz)) *
+           sizeof(mint_t);
+  };
+  const size_t budget = storage::get_memory_budget();
+
+  std::vector<Factor<mint_t>> wave;
+  for (size_t begin = 0, end = 0; begin < ranges.size(); begin = end) {
+    // wave[0] is the product so far, if any.
+    size_t live_bytes = wave.empty() ? 0 : mobius_sz * sizeof(mint_t);
+    do {
+      live_bytes += peak_bytes(ranges[end++]);
+    } while (end < ranges.size() &&
+             live_bytes + peak_bytes(ranges[end]) <= budget);
+
+    const size_t num_products = wave.size();
+    wave.resize(num_products + end - begin);
+    parallel::parallel_for(end - begin, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        wave[num_products + i] = compute(ranges[begin + i]);
       }
-      {
-        mint cur = 0;
-        for (int64_t power = max_power; power >= 0; power--) {
-          // We want unique_mults[0] * 1;
-          cur = unique_mults[power] - cur;
+    });
+    // Multiplies the pairs until a single factor is left.
+    while (wave.size() > 1) {
+      const size_t num_pairs = wave.size() / 2;
+      parallel::parallel_for(num_pairs, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          auto& other = wave[2 * i + 1];
+          multiply_factors(wave[2 * i], other, max_cell, mobius_sz);
+          mapped_vector<mint_t>().swap(other.values);  // Frees it.
         }
-        mobius[i] = cur;
+      });
+      for (size_t i = 1; i < wave.size(); ++i) {
+        if (i % 2 == 0) wave[i / 2] = std::move(wave[i]);
       }
+      wave.resize((wave.size() + 1) / 2);
     }
   }
-  return mobius;
+  return std::move(wave[0].values);
 }
 
-void truncate_and_resize(std::vector<mint>& v, size_t max_cell, size_t new_sz) {
-  intt(v, "Truncate INTT");
-  ASSERT_FATAL(max_cell < new_sz);
-  for (size_t i = max_cell + 1; i < std::min(v.size(), new_sz); ++i) v[i] = 0;
-  v.resize(new_sz);
-  ntt(v, "Truncate NTT");
+// A sparse polynomial 1 + sum of the terms, with increasing shifts.
+template <typename mint_t>
+using SparsePolynomial = std::vector<mint_span::SparseTerm<mint_t>>;
+
+// The product of the polynomials, without the terms of degree >= size.
+template <typename mint_t>
+SparsePolynomial<mint_t> multiply_sparse(const SparsePolynomial<mint_t>& a,
+                                         const SparsePolynomial<mint_t>& b,
+                                         size_t size) {
+  std::map<size_t, mint_t> terms;
+  for (const auto& x : a) terms[x.shift] += x.coef;
+  for (const auto& y : b) {
+    terms[y.shift] += y.coef;
+    for (const auto& x : a) {
+      if (x.shift + y.shift < size) terms[x.shift + y.shift] += x.coef * y.coef;
+    }
+  }
+  SparsePolynomial<mint_t> res;
+  for (const auto& [shift, coef] : terms) {
+    if (shift < size && coef != 0) res.push_back({shift, coef});
+  }
+  return res;
+}
+
+// Multiplies the cells 0..size - 1 of v by the product of (1 - x^cell(p)) over
+// the primes (truncated to size). The primes of a cell are a single factor
+// (1 - x^cell)^count, and the factors of consecutive cells are multiplied into
+// sparse polynomials of up to max_sweep_terms terms, so a pass over v applies
+// several primes (the terms with the same number of primes read close
+// positions, which share the cache).
+// A pass writes the product to a second buffer, so it reads only the cells
+// before it and the whole pass splits between the threads. The buffer is the
+// end of v when v holds 2 * size cells (as after the transforms), and the
+// cells after size are left unspecified.
+template <typename mint_t>
+void multiply_by_small_primes(mapped_vector<mint_t>& v, size_t size,
+                              const std::vector<prime_t>& primes,
+                              double lg2_prec) {
+  constexpr size_t max_sweep_terms = 8;
+  std::vector<SparsePolynomial<mint_t>> sweeps(1);
+  for (size_t i = 0; i < primes.size();) {
+    const size_t cell = get_cell(primes[i], lg2_prec);
+    size_t count = 0;
+    for (; i < primes.size() && get_cell(primes[i], lg2_prec) == cell; ++i) {
+      ++count;
+    }
+    // (1 - x^cell)^count
+    SparsePolynomial<mint_t> factor;
+    mint_t binomial = 1;
+    for (size_t k = 1; k <= count && k * cell < size; ++k) {
+      binomial *= mint_t(count - k + 1) * mint_t(k).inverse();
+      factor.push_back({k * cell, k % 2 == 0 ? binomial : -binomial});
+    }
+    auto product = multiply_sparse(sweeps.back(), factor, size);
+    if (!sweeps.back().empty() && product.size() > max_sweep_terms) {
+      sweeps.push_back(std::move(factor));
+    } else {
+      sweeps.back() = std::move(product);
+    }
+  }
+
+  mapped_vector<mint_t> scratch;
+  std::span<mint_t> src(v.data(), size), dst;
+  if (v.size() >= 2 * size) {
+    dst = std::span(v.data() + size, size);
+  } else {
+    scratch.resize(size);
+    dst = std::span(scratch.data(), size);
+  }
+  for (size_t sweep :
+       tqdm::title_range<size_t>("SmallPrimeNaiveConvolution", sweeps.size())) {
+    if (sweeps[sweep].empty()) continue;
+    const mint_span::SparseTerms<mint_t> terms(sweeps[sweep]);
+    parallel::parallel_for(
+        size,
+        [&](size_t begin, size_t end) {
+          mint_span::sparse_multiply(dst, src, begin, end, terms);
+        },
+        min_coefs_per_thread);
+    std::swap(src, dst);
+  }
+  if (src.data() != v.data()) {
+    parallel::parallel_for(
+        size,
+        [&](size_t begin, size_t end) {
+          std::copy(src.begin() + begin, src.begin() + end, v.begin() + begin);
+        },
+        min_coefs_per_thread);
+  }
 }
 }  // namespace mobius::details
 
-std::vector<mint> get_mobius_using_newton(prime_t upto, double lg2_prec,
-                                          prime_t max_prime) {
-  using namespace mobius::details;
-  size_t max_cell = get_cell(upto, lg2_prec);
-  size_t mobius_sz = ceil_power_of_2(max_cell * 2);
+std::vector<mobius::details::PrimeRange> mobius::details::get_prime_ranges(
+    prime_t upto, double lg2_prec, prime_t max_prime) {
+  const size_t max_cell = get_cell(upto, lg2_prec);
+  const size_t mobius_sz = get_mobius_ntt_size(upto, lg2_prec);
   // Setting mobius_sz to max_cell * 2 also change the thresholds jumps:
   // For 2 this means [p, p^2, p^4, ...] while for 3 it means [p, p^3, p^9, ...]
   // While this does reduce the number of iterations, we pay more per iteration
   // because of the larger vector size (both in the fft and the newton
   // identities).
-
-  constexpr prime_t max_prime_for_naive_conv = 1ll << 10;
-
   std::vector<prime_t> thresholds({max_prime_for_naive_conv + 1});
   while (thresholds.back() < max_prime + 1) {
     size_t max_power = get_max_power(upto, thresholds.back());
-    size_t max_cell_no_overflow = mobius_sz / max_power;
+    // Below mobius_sz, so that the transforms of the range (of size
+    // ceil_ntt_size(inner_max_cell + 1)) are at most mobius_sz.
+    size_t max_cell_no_overflow = (mobius_sz - 1) / max_power;
     prime_t prime = get_cell_end(max_cell_no_overflow, lg2_prec);
     thresholds.push_back(std::min(prime, max_prime + 1));
   }
 
-  std::vector<mint> mobius;
-  if (thresholds.size() < 2) {
+  std::vector<PrimeRange> ranges;
+  for (size_t i = 1; i < thresholds.size(); ++i) {
+    prime_t max_prime_ = thresholds[i] - 1, min_prime_ = thresholds[i - 1];
+    size_t max_prime_cell = get_cell(max_prime_, lg2_prec);
+    size_t max_power = get_max_power(upto, min_prime_);
+    size_t inner_max_cell = max_prime_cell * max_power;
+    // Holds the cells up to inner_max_cell without wrapping around.
+    size_t vec_sz = ceil_ntt_size(inner_max_cell + 1);
+    if (thresholds.size() > 2 && inner_max_cell + max_cell < mobius_sz) {
+      // Multiplied by the truncated others without any transform.
+      vec_sz = mobius_sz;
+    }
+    ASSERT_FATAL(vec_sz <= mobius_sz);
+    ranges.push_back({min_prime_, max_prime_, vec_sz, inner_max_cell});
+  }
+  return ranges;
+}
+
+size_t get_mobius_ntt_size(prime_t upto, double lg2_prec) {
+  // 2^k or 3 * 2^k, whichever is smaller, above the cells of a product of
+  // two vectors truncated to the max cell.
+  return ceil_ntt_size(get_cell(upto, lg2_prec) * 2 + 1);
+}
+
+template <typename mint_t>
+mapped_vector<mint_t> get_mobius_using_newton(prime_t upto, double lg2_prec,
+                                              prime_t max_prime) {
+  using namespace mobius::details;
+  size_t max_cell = get_cell(upto, lg2_prec);
+  size_t mobius_sz = get_mobius_ntt_size(upto, lg2_prec);
+  const auto ranges = get_prime_ranges(upto, lg2_prec, max_prime);
+
+  mapped_vector<mint_t> mobius;
+  if (ranges.empty()) {
     mobius.resize(mobius_sz);
     mobius[0] = 1;  // {1, 0, 0, 0, ...}
   } else {
-    for (size_t i = 1; i < thresholds.size(); ++i) {
-      prime_t max_prime_ = thresholds[i] - 1, min_prime_ = thresholds[i - 1];
-      size_t max_prime_cell = get_cell(max_prime_, lg2_prec);
-      size_t max_power = get_max_power(upto, min_prime_);
-      size_t inner_max_cell = max_prime_cell * max_power;
-      size_t vec_sz = ceil_power_of_2(inner_max_cell);
-      auto cur = get_mobius_prime_range(upto, lg2_prec, min_prime_, max_prime_,
-                                        vec_sz);
-      if (i == 1) {
-        mobius = std::move(cur);  // No need to multiply or truncate.
-      } else {
-        truncate_and_resize(cur, max_cell, mobius_sz);
-        truncate_and_resize(mobius, max_cell, mobius_sz);
-        for (size_t ind = 0; ind < mobius.size(); ++ind) {
-          mobius[ind] *= cur[ind];
-        }
-      }
-    }
+    mobius = multiply_prime_ranges<mint_t>(upto, lg2_prec, max_cell, mobius_sz,
+                                           ranges);
 
-    intt(mobius, "INTT finalize mobius");
+    intt_bit_reversed_pruned(mobius, std::min(mobius.size(), max_cell + 1),
+                             "INTT finalize mobius");
+    // A single range may be shorter than max_cell + 1, the rest is zero.
+    if (mobius.size() <= max_cell) mobius.resize(max_cell + 1);
   }
-  for (size_t i = max_cell + 1; i < mobius.size(); ++i) mobius[i] = 0;
   {
     // SmallPrimeNaiveConvolution
     auto small_prime_real_bound = std::min(max_prime_for_naive_conv, max_prime);
     auto small_primes = get_primes_by_sieve(small_prime_real_bound);
-    for (size_t p_idx : tqdm::title_range<size_t>("SmallPrimeNaiveConvolution",
-                                                  small_primes.size())) {
-      prime_t p = small_primes[p_idx];
-      int64_t cell = get_cell(p, lg2_prec);
-      for (int64_t i = max_cell; i >= cell; --i) {
-        mobius[i] -= mobius[i - cell];
-      }
-    }
+    multiply_by_small_primes(mobius, max_cell + 1, small_primes, lg2_prec);
   }
+  for (size_t i = max_cell + 1; i < mobius.size(); ++i) mobius[i] = 0;
   return mobius;
-}
\ No newline at end of file
+}
+
+template mapped_vector<mint> get_mobius_using_newton(prime_t, double, prime_t);
+template mapped_vector<mint2> get_mobius_using_newton(prime_t, double, prime_t);
+template mapped_vector<mint3> get_mobius_using_newton(prime_t, double, prime_t);
+template mapped_vector<mint32> get_mobius_using_newton(prime_t, double,
+                                                       prime_t);
+template mapped_vector<mint32_2> get_mobius_using_newton(prime_t, double,
+                                                         prime_t);
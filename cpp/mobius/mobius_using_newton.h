@@ -2,12 +2,33 @@
 
 #include <vector>
 
+#include "../helpers/mapped_vector.h"
 #include "../helpers/mod_int.h"
 #include "../helpers/types.h"
 
 namespace mobius::details {
 size_t get_max_power(prime_t upto, prime_t base);
+
+// The primes up to this one are multiplied naively, the others in ranges.
+constexpr prime_t max_prime_for_naive_conv = 1ll << 10;
+
+struct PrimeRange {
+  prime_t min_prime, max_prime;
+  size_t vec_sz;    // The size of its transforms.
+  size_t max_cell;  // The largest cell of the range's product.
+};
+
+// The ranges of the primes in (max_prime_for_naive_conv, max_prime], whose
+// transforms are at most get_mobius_ntt_size.
+std::vector<PrimeRange> get_prime_ranges(prime_t upto, double lg2_prec,
+                                         prime_t max_prime);
 }  // namespace mobius::details
 
-std::vector<mint> get_mobius_using_newton(prime_t upto, double lg2_prec,
-                                          prime_t max_prime);
+// The size of the transforms of get_mobius_using_newton (the largest one).
+size_t get_mobius_ntt_size(prime_t upto, double lg2_prec);
+
+// Instantiated for the NttModInts (see helpers/moduli.h).
+// The result is out-of-core if storage::set_dir was called.
+template <typename mint_t = mint>
+mapped_vector<mint_t> get_mobius_using_newton(prime_t upto, double lg2_prec,
+                                              prime_t max_prime);